@@ -0,0 +1,84 @@
+// Arena module implementation
+#include "arena.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+
+Arena::Arena(std::size_t blockSize)
+  : m_blockSize(blockSize), m_blocks(nullptr), m_cursor(nullptr), m_end(nullptr),
+    m_finalizers(nullptr), m_used(0) {}
+
+Arena::~Arena() {
+  release();
+  std::free(m_blocks);
+}
+
+void* Arena::allocate(std::size_t size, std::size_t align) {
+  std::uintptr_t current = reinterpret_cast<std::uintptr_t>(m_cursor);
+  std::uintptr_t aligned = (current + align - 1) & ~(std::uintptr_t(align) - 1);
+
+  if (m_cursor == nullptr || aligned + size > reinterpret_cast<std::uintptr_t>(m_end)) {
+    newBlock(size + align);
+    current = reinterpret_cast<std::uintptr_t>(m_cursor);
+    aligned = (current + align - 1) & ~(std::uintptr_t(align) - 1);
+  }
+
+  m_cursor = reinterpret_cast<char*>(aligned + size);
+  m_used += size;
+  return reinterpret_cast<void*>(aligned);
+}
+
+void Arena::release() noexcept {
+  // Objects are destroyed in reverse order of creation
+  while (m_finalizers) {
+    Finalizer* finalizer = m_finalizers;
+    m_finalizers = finalizer->next;
+    finalizer->destroy(finalizer->object);
+  }
+
+  if (!m_blocks) {
+    return;
+  }
+
+  // Keep the oldest block, at the head, for the next round of allocations
+  Block* block = m_blocks;
+  Block* later = block->next;
+  while (later) {
+    Block* next = later->next;
+    std::free(later);
+    later = next;
+  }
+  block->next = nullptr;
+  m_cursor = reinterpret_cast<char*>(block + 1);
+  m_end = reinterpret_cast<char*>(block + 1) + block->size;
+  m_used = 0;
+}
+
+void Arena::addFinalizer(void (*destroy)(void*), void* object) {
+  Finalizer* finalizer = static_cast<Finalizer*>(allocate(sizeof(Finalizer), alignof(Finalizer)));
+  finalizer->destroy = destroy;
+  finalizer->object = object;
+  finalizer->next = m_finalizers;
+  m_finalizers = finalizer;
+}
+
+void Arena::newBlock(std::size_t minSize) {
+  std::size_t size = minSize > m_blockSize ? minSize : m_blockSize;
+  Block* block = static_cast<Block*>(std::malloc(sizeof(Block) + size));
+  if (!block) {
+    throw std::bad_alloc();
+  }
+  block->size = size;
+
+  // The newest block goes second so the oldest stays at the head of the
+  // list; allocation only ever happens in the newest block
+  if (m_blocks) {
+    block->next = m_blocks->next;
+    m_blocks->next = block;
+  } else {
+    block->next = nullptr;
+    m_blocks = block;
+  }
+  m_cursor = reinterpret_cast<char*>(block + 1);
+  m_end = m_cursor + size;
+}
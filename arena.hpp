@@ -0,0 +1,81 @@
+// Arena module declarations
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+// system includes
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Bump allocator that hands out memory from large blocks. Everything
+// allocated from an arena is released at once by release() or the
+// destructor; there is no per-object free.
+//
+// Objects with non-trivial destructors created through create() are
+// recorded and destroyed on release, so the cost of releasing an arena is
+// O(1) for trivially destructible objects and one destructor call for the
+// others.
+class Arena {
+public:
+  explicit Arena(std::size_t blockSize = 64 * 1024);
+  ~Arena();
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  void* allocate(std::size_t size, std::size_t align);
+
+  template <typename T, typename... Args>
+  T* create(Args&&... args) {
+    void* memory = allocate(sizeof(T), alignof(T));
+    T* object = new (memory) T(std::forward<Args>(args)...);
+    if (!std::is_trivially_destructible<T>::value) {
+      addFinalizer(&destroy<T>, object);
+    }
+    return object;
+  }
+
+  // Uninitialized storage for n objects of trivially destructible type T
+  template <typename T>
+  T* allocateArray(std::size_t n) {
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "arena arrays are never destroyed");
+    return static_cast<T*>(allocate(sizeof(T) * n, alignof(T)));
+  }
+
+  // Destroy every object and give back all memory except the first block,
+  // which is kept for reuse
+  void release() noexcept;
+
+  std::size_t bytesUsed() const noexcept { return m_used; }
+
+private:
+  struct Block {
+    Block* next;
+    std::size_t size;
+  };
+
+  struct Finalizer {
+    void (*destroy)(void*);
+    void* object;
+    Finalizer* next;
+  };
+
+  template <typename T>
+  static void destroy(void* object) {
+    static_cast<T*>(object)->~T();
+  }
+
+  void addFinalizer(void (*destroy)(void*), void* object);
+  void newBlock(std::size_t minSize);
+
+  std::size_t m_blockSize;
+  Block* m_blocks;
+  char* m_cursor;
+  char* m_end;
+  Finalizer* m_finalizers;
+  std::size_t m_used;
+};
+
+#endif
@@ -0,0 +1,698 @@
+// Interpreter benchmarks
+//
+// Usage: bench_interpreter <benchmark> [args...]
+//   parse [max_bytes]   parse time for generated programs from 1 KB up to
+//                       max_bytes (default 100 MB), growing 10x per step
+//   eval [nodes]        nodes/second of each evaluation backend on a deep
+//                       and a wide program of about nodes nodes (default 30000)
+//   dispatch            nanoseconds per evaluation of a one-operator program,
+//                       for every operator in the order evalExpr used to test
+//                       them
+//   formulas            evaluations/second of each backend on numeric
+//                       formulas over defined symbols, the JIT's target
+//   conjunction         nanoseconds per evaluation of 100-clause and / or
+//                       chains decided by an early or by the last clause
+//   defines             nanoseconds per define in programs of 1000 defines
+//                       binding literals, copies of symbols, or arithmetic
+//   lookups             lookups/second in environments of 10, 10k and 1M
+//                       bindings, against a std::unordered_map of the same
+//   startup [bindings]  milliseconds to set up environments of up to
+//                       bindings definitions (default 1000000) by evaluating
+//                       the preamble, against loading a saved image whose
+//                       names are new to the process (cold) or already
+//                       interned (warm)
+//   shared [threads]    evaluations/second of interpreters on 1 up to
+//                       threads threads (default 8) reading one shared
+//                       environment of 100000 constants
+#include "interpreter.hpp"
+#include "environment.hpp"
+#include "shared_environment.hpp"
+#include "expression.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// A wide, shallow program of roughly the requested size:
+// (+ (* 2 (- 3 1.5)) (* 2 (- 3 1.5)) ... )
+std::string programOfSize(std::size_t bytes) {
+  static const std::string term = "(* 2 (- 3 1.5)) ";
+  std::string program = "(+ ";
+  program.reserve(bytes + term.size());
+  while (program.size() < bytes) {
+    program += term;
+  }
+  program += ")";
+  return program;
+}
+
+// (+ 1 (+ 1 (+ 1 ... 1))) nested depth levels deep; 3 * depth + 1 nodes
+std::string deepProgram(std::size_t depth) {
+  std::string program;
+  for (std::size_t i = 0; i < depth; ++i) {
+    program += "(+ 1 ";
+  }
+  program += "1";
+  program += std::string(depth, ')');
+  return program;
+}
+
+// (+ (* 2 1.5) (* 2 1.5) ... 0) with 3 * terms + 2 nodes
+std::string wideProgram(std::size_t terms) {
+  std::string program = "(+ ";
+  for (std::size_t i = 0; i < terms; ++i) {
+    program += "(* 2 1.5) ";
+  }
+  program += "0)";
+  return program;
+}
+
+const char* backendName(Interpreter::Backend backend) {
+  switch (backend) {
+    case Interpreter::Backend::TreeWalker: return "tree";
+    case Interpreter::Backend::FlatAST: return "flat";
+    case Interpreter::Backend::Bytecode: return "bytecode";
+    case Interpreter::Backend::Jit: return "jit";
+    case Interpreter::Backend::Tiered: return "tiered";
+  }
+  return "?";
+}
+
+// Evaluate program repeatedly for about a second; returns nodes/second.
+// The programs have no defines, so one parsed Interpreter can be
+// evaluated over and over.
+double nodesPerSecond(const std::string & program, std::size_t nodes, Interpreter::Backend backend) {
+  std::istringstream iss(program);
+  Interpreter interp;
+  interp.setBackend(backend);
+  if (!interp.parse(iss)) {
+    std::cerr << "parse failed" << std::endl;
+    return 0;
+  }
+  interp.eval(); // first call builds any backend-specific form
+
+  std::size_t rounds = 0;
+  Clock::time_point start = Clock::now();
+  double elapsed = 0;
+  while (elapsed < 1.0) {
+    for (int i = 0; i < 10; ++i) {
+      interp.eval();
+    }
+    rounds += 10;
+    elapsed = secondsSince(start);
+  }
+  return nodes * rounds / elapsed;
+}
+
+int benchEval(int argc, char* argv[]) {
+  std::size_t nodes = 30000;
+  if (argc > 0) {
+    nodes = std::strtoull(argv[0], nullptr, 10);
+  }
+
+  struct Shape {
+    const char* name;
+    std::string program;
+    std::size_t nodes;
+  };
+  std::vector<Shape> shapes = {
+    {"deep", deepProgram(nodes / 3), 3 * (nodes / 3) + 1},
+    {"wide", wideProgram(nodes / 3), 3 * (nodes / 3) + 2},
+  };
+  std::vector<Interpreter::Backend> backends = {
+    Interpreter::Backend::TreeWalker, Interpreter::Backend::FlatAST,
+    Interpreter::Backend::Bytecode, Interpreter::Backend::Tiered,
+  };
+
+  std::cout << std::setw(8) << "shape" << std::setw(10) << "backend"
+            << std::setw(16) << "nodes/s" << std::endl;
+  for (const Shape & shape : shapes) {
+    for (Interpreter::Backend backend : backends) {
+      std::cout << std::setw(8) << shape.name << std::setw(10) << backendName(backend)
+                << std::setw(16) << std::fixed << std::setprecision(0)
+                << nodesPerSecond(shape.program, shape.nodes, backend) << std::endl;
+    }
+  }
+  return 0;
+}
+
+// Time repeated eval() of a parsed program; returns nanoseconds per call
+double nanosPerEval(const std::string & program, Interpreter::Backend backend) {
+  std::istringstream iss(program);
+  Interpreter interp;
+  interp.setBackend(backend);
+  if (!interp.parse(iss)) {
+    std::cerr << "parse failed: " << program << std::endl;
+    return 0;
+  }
+  for (int i = 0; i < 10000; ++i) {
+    interp.eval(); // warm up
+  }
+
+  const std::size_t rounds = 200000;
+  Clock::time_point start = Clock::now();
+  for (std::size_t i = 0; i < rounds; ++i) {
+    interp.eval();
+  }
+  return secondsSince(start) * 1e9 / rounds;
+}
+
+int benchDispatch() {
+  // define is left out: a name can only be defined once per interpreter
+  const char* programs[] = {
+    "(+ 1 2)", "(if True 1 2)", "(begin 1 2)", "(- 1 2)", "(/ 1 2)", "(* 1 2)",
+    "(< 1 2)", "(<= 1 2)", "(> 1 2)", "(>= 1 2)", "(= 1 2)",
+    "(and True False)", "(or True False)", "(not True)"
+  };
+  std::vector<Interpreter::Backend> backends = {
+    Interpreter::Backend::TreeWalker, Interpreter::Backend::FlatAST,
+    Interpreter::Backend::Bytecode, Interpreter::Backend::Tiered,
+  };
+
+  std::cout << std::setw(20) << "program";
+  for (Interpreter::Backend backend : backends) {
+    std::cout << std::setw(12) << backendName(backend);
+  }
+  std::cout << "   (ns/eval)" << std::endl;
+
+  for (const char* program : programs) {
+    std::cout << std::setw(20) << program;
+    for (Interpreter::Backend backend : backends) {
+      std::cout << std::setw(12) << std::fixed << std::setprecision(1)
+                << nanosPerEval(program, backend);
+    }
+    std::cout << std::endl;
+  }
+  return 0;
+}
+
+// Define x, y and z, then evaluate formula over them for about a second;
+// returns evaluations/second
+double evalsPerSecond(const std::string & formula, Interpreter::Backend backend) {
+  Interpreter interp;
+  interp.setBackend(backend);
+  std::istringstream preamble("(begin (define x 1.5) (define y -2) (define z 0.25) z)");
+  if (!interp.parse(preamble)) {
+    return 0;
+  }
+  interp.eval();
+
+  std::istringstream iss(formula);
+  if (!interp.parse(iss)) {
+    std::cerr << "parse failed: " << formula << std::endl;
+    return 0;
+  }
+  interp.eval(); // first call compiles
+
+  std::size_t rounds = 0;
+  Clock::time_point start = Clock::now();
+  double elapsed = 0;
+  while (elapsed < 1.0) {
+    for (int i = 0; i < 1000; ++i) {
+      interp.eval();
+    }
+    rounds += 1000;
+    elapsed = secondsSince(start);
+  }
+  return rounds / elapsed;
+}
+
+int benchFormulas() {
+  const char* formulas[] = {
+    "(+ (* x x) (* y y))",
+    "(/ (- (* x y) z) (+ x (* y z) 1))",
+    "(* (+ x 1) (+ y 2) (+ z 3) (- x y) (- z))",
+    "(< (+ (* x x) (* y y)) (* z z 100))",
+    "(+ (* 3 x x x) (* -2 x x) (* 7 x) (/ (- y z) (+ (* x x) 1)) (* pi z z))",
+  };
+  std::vector<Interpreter::Backend> backends = {
+    Interpreter::Backend::TreeWalker, Interpreter::Backend::FlatAST,
+    Interpreter::Backend::Bytecode, Interpreter::Backend::Jit,
+    Interpreter::Backend::Tiered,
+  };
+
+  std::cout << std::setw(12) << "formula";
+  for (Interpreter::Backend backend : backends) {
+    std::cout << std::setw(12) << backendName(backend);
+  }
+  std::cout << "   (evals/s)" << std::endl;
+
+  for (std::size_t i = 0; i < sizeof(formulas) / sizeof(formulas[0]); ++i) {
+    std::cout << std::setw(12) << i + 1;
+    for (Interpreter::Backend backend : backends) {
+      std::cout << std::setw(12) << std::fixed << std::setprecision(0)
+                << evalsPerSecond(formulas[i], backend);
+    }
+    std::cout << std::endl;
+  }
+  return 0;
+}
+
+// (op clause clause ... ) with 100 clauses; the clause at position
+// decisive (0-based) is the one that decides the result
+std::string chain(const char* op, const char* usual, const char* deciding, std::size_t decisive) {
+  std::string program = std::string("(") + op;
+  for (std::size_t i = 0; i < 100; ++i) {
+    program += " ";
+    program += i == decisive ? deciding : usual;
+  }
+  return program + ")";
+}
+
+int benchConjunction() {
+  struct Chain {
+    const char* name;
+    std::string program;
+  };
+  std::vector<Chain> chains = {
+    {"and, 2nd false", chain("and", "(< 1 2)", "(> 1 2)", 1)},
+    {"and, all true", chain("and", "(< 1 2)", "(< 1 2)", 99)},
+    {"or, 2nd true", chain("or", "(> 1 2)", "(< 1 2)", 1)},
+    {"or, last true", chain("or", "(> 1 2)", "(< 1 2)", 99)},
+  };
+  std::vector<Interpreter::Backend> backends = {
+    Interpreter::Backend::TreeWalker, Interpreter::Backend::FlatAST,
+    Interpreter::Backend::Bytecode, Interpreter::Backend::Tiered,
+  };
+
+  std::cout << std::setw(16) << "chain";
+  for (Interpreter::Backend backend : backends) {
+    std::cout << std::setw(12) << backendName(backend);
+  }
+  std::cout << "   (ns/eval)" << std::endl;
+
+  for (const Chain & c : chains) {
+    std::cout << std::setw(16) << c.name;
+    for (Interpreter::Backend backend : backends) {
+      std::cout << std::setw(12) << std::fixed << std::setprecision(1)
+                << nanosPerEval(c.program, backend);
+    }
+    std::cout << std::endl;
+  }
+  return 0;
+}
+
+// (begin (define d0 1) (define d1 <value of d0>) ... (d999)), where each
+// value is made from the previous name by form
+std::string definitions(const char* form) {
+  std::string program = "(begin (define d0 1)";
+  for (std::size_t i = 1; i < 1000; ++i) {
+    std::string previous = "d" + std::to_string(i - 1);
+    std::string value = form;
+    std::size_t at = value.find('@');
+    if (at != std::string::npos) {
+      value.replace(at, 1, previous);
+    }
+    program += " (define d" + std::to_string(i) + " " + value + ")";
+  }
+  return program + " (d999))";
+}
+
+// Each evaluation needs a fresh environment, so only eval() is timed
+double nanosPerDefine(const std::string & program, Interpreter::Backend backend) {
+  std::size_t rounds = 0;
+  double elapsed = 0;
+  while (elapsed < 1.0) {
+    std::istringstream iss(program);
+    Interpreter interp;
+    interp.setBackend(backend);
+    interp.parse(iss);
+    Clock::time_point start = Clock::now();
+    interp.eval();
+    elapsed += secondsSince(start);
+    ++rounds;
+  }
+  return elapsed * 1e9 / (rounds * 1000.0);
+}
+
+int benchDefines() {
+  struct Kind {
+    const char* name;
+    std::string program;
+  };
+  std::vector<Kind> kinds = {
+    {"literal", definitions("2")},
+    {"copy", definitions("@")},
+    {"arithmetic", definitions("(+ @ 1)")},
+  };
+  std::vector<Interpreter::Backend> backends = {
+    Interpreter::Backend::TreeWalker, Interpreter::Backend::FlatAST,
+    Interpreter::Backend::Bytecode,
+  };
+
+  std::cout << std::setw(12) << "value";
+  for (Interpreter::Backend backend : backends) {
+    std::cout << std::setw(12) << backendName(backend);
+  }
+  std::cout << "   (ns/define)" << std::endl;
+
+  for (const Kind & kind : kinds) {
+    std::cout << std::setw(12) << kind.name;
+    for (Interpreter::Backend backend : backends) {
+      std::cout << std::setw(12) << std::fixed << std::setprecision(1)
+                << nanosPerDefine(kind.program, backend);
+    }
+    std::cout << std::endl;
+  }
+  return 0;
+}
+
+// Lookups/second of find over a random sequence of the bound ids
+template <typename Find>
+double lookupsPerSecond(const std::vector<SymbolId> & order, Find find) {
+  std::size_t rounds = 0;
+  double sum = 0;
+  Clock::time_point start = Clock::now();
+  double elapsed = 0;
+  while (elapsed < 0.5) {
+    for (SymbolId id : order) {
+      sum += find(id)->getNumber();
+    }
+    ++rounds;
+    elapsed = secondsSince(start);
+  }
+  if (sum < 0) {
+    std::cout << sum; // keeps the lookups
+  }
+  return rounds * order.size() / elapsed;
+}
+
+int benchLookups() {
+  std::cout << std::setw(12) << "bindings" << std::setw(16) << "Environment"
+            << std::setw(16) << "unordered_map" << "   (lookups/s)" << std::endl;
+
+  for (std::size_t count : {std::size_t(10), std::size_t(10000), std::size_t(1000000)}) {
+    Environment env;
+    std::unordered_map<SymbolId, Expression> map;
+    std::vector<SymbolId> ids;
+    for (std::size_t i = 0; i < count; ++i) {
+      ids.push_back(intern("binding" + std::to_string(i)));
+      env.define(ids.back(), Expression(1.));
+      map[ids.back()] = Expression(1.);
+    }
+
+    std::vector<SymbolId> order;
+    std::uint64_t random = 88172645463325252ull;
+    for (std::size_t i = 0; i < (1u << 20); ++i) {
+      random ^= random << 13;
+      random ^= random >> 7;
+      random ^= random << 17;
+      order.push_back(ids[random % count]);
+    }
+
+    double flat = lookupsPerSecond(order, [&env](SymbolId id) { return env.lookup(id); });
+    double node = lookupsPerSecond(order, [&map](SymbolId id) { return &map.find(id)->second; });
+    std::cout << std::setw(12) << count << std::setw(16) << std::fixed << std::setprecision(0)
+              << flat << std::setw(16) << node << std::endl;
+  }
+  return 0;
+}
+
+// (begin (define c0 0.5) (define c1 (+ c0 1)) (define c2 True) ... c0)
+// binding count names to numbers, arithmetic on them and booleans; the
+// names start with prefix rather than c
+std::string preamble(std::size_t count, const std::string & prefix) {
+  std::string program = "(begin (define " + prefix + "0 0.5)";
+  for (std::size_t i = 1; i < count; ++i) {
+    std::string name = prefix + std::to_string(i);
+    switch (i % 3) {
+      case 0:
+        program += " (define " + name + " " + std::to_string(i) + ".25)";
+        break;
+      case 1:
+        program += " (define " + name + " (+ " + prefix + std::to_string(i - 1) + " 1))";
+        break;
+      default:
+        program += " (define " + name + " True)";
+        break;
+    }
+  }
+  return program + " " + prefix + "0)";
+}
+
+// Saved image of the environment program sets up. It is built in a child
+// process, so this one has not interned the names it binds; empty on
+// failure.
+std::string imageOf(const std::string & program) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return std::string();
+  }
+  pid_t child = fork();
+  if (child < 0) {
+    close(fds[0]);
+    close(fds[1]);
+    return std::string();
+  }
+
+  if (child == 0) {
+    close(fds[0]);
+    Interpreter interp;
+    std::istringstream source(program);
+    std::ostringstream out;
+    if (interp.parse(source)) {
+      interp.eval();
+      interp.snapshot()->save(out);
+    }
+    std::string image = out.str();
+    for (std::size_t done = 0; done < image.size();) {
+      ssize_t written = write(fds[1], image.data() + done, image.size() - done);
+      if (written <= 0) {
+        _exit(1);
+      }
+      done += static_cast<std::size_t>(written);
+    }
+    _exit(0);
+  }
+
+  close(fds[1]);
+  std::string image;
+  char buffer[65536];
+  ssize_t got;
+  while ((got = read(fds[0], buffer, sizeof(buffer))) > 0) {
+    image.append(buffer, static_cast<std::size_t>(got));
+  }
+  close(fds[0]);
+  int status = 0;
+  waitpid(child, &status, 0);
+  if (got < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    return std::string();
+  }
+  return image;
+}
+
+int benchStartup(int argc, char* argv[]) {
+  std::size_t maxBindings = 1000000;
+  if (argc > 0) {
+    maxBindings = std::strtoull(argv[0], nullptr, 10);
+  }
+
+  std::cout << std::setw(12) << "bindings" << std::setw(12) << "evaluate"
+            << std::setw(12) << "cold load" << std::setw(12) << "warm load"
+            << std::setw(14) << "image bytes" << "   (ms)" << std::endl;
+
+  for (std::size_t count = 1000; count <= maxBindings; count *= 10) {
+    // Every measurement binds names of its own, so each that should pay
+    // for interning them does
+    std::string tag = std::to_string(count) + "_";
+    std::string image = imageOf(preamble(count, "l" + tag));
+    if (image.empty()) {
+      std::cerr << "no image of " << count << " bindings" << std::endl;
+      return 1;
+    }
+
+    // read the saved image, interning its names
+    Clock::time_point start = Clock::now();
+    std::istringstream cold(image);
+    EnvironmentSnapshot loaded = std::make_shared<const Environment>(Environment::load(cold));
+    double coldLoad = secondsSince(start);
+
+    if (loaded->symbols.size() != count) {
+      std::cerr << "loaded " << loaded->symbols.size() << " of " << count << " bindings"
+                << std::endl;
+      return 1;
+    }
+
+    // and again, with the names interned
+    start = Clock::now();
+    std::istringstream warm(image);
+    EnvironmentSnapshot reloaded = std::make_shared<const Environment>(Environment::load(warm));
+    double warmLoad = secondsSince(start);
+
+    // parse and evaluate the preamble from its source text
+    std::string program = preamble(count, "e" + tag);
+    start = Clock::now();
+    Interpreter interp;
+    std::istringstream source(program);
+    if (!interp.parse(source)) {
+      std::cerr << "parse failed at " << count << " bindings" << std::endl;
+      return 1;
+    }
+    interp.eval();
+    EnvironmentSnapshot evaluated = interp.snapshot();
+    double evaluate = secondsSince(start);
+
+    std::cout << std::setw(12) << count << std::setw(12) << std::fixed << std::setprecision(2)
+              << evaluate * 1e3 << std::setw(12) << coldLoad * 1e3 << std::setw(12)
+              << warmLoad * 1e3 << std::setw(14) << image.size() << std::endl;
+  }
+  return 0;
+}
+
+// Each thread evaluates a formula over shared constants for about a
+// second in its own interpreter; returns evaluations/second of all threads
+double sharedEvalsPerSecond(std::shared_ptr<const SharedEnvironment> shared, std::size_t threads) {
+  std::vector<std::size_t> counts(threads);
+  std::vector<std::thread> workers;
+  for (std::size_t t = 0; t < threads; ++t) {
+    workers.emplace_back([&shared, &counts, t]() {
+      Interpreter interp;
+      interp.setBackend(Interpreter::Backend::Bytecode);
+      interp.share(shared);
+      std::istringstream iss("(+ (* k17 k42) (- k99999 k1) (/ k500 k250))");
+      interp.parse(iss);
+      std::size_t count = 0;
+      Clock::time_point start = Clock::now();
+      while (secondsSince(start) < 1.0) {
+        for (int i = 0; i < 1000; ++i) {
+          interp.eval();
+        }
+        count += 1000;
+      }
+      counts[t] = count;
+    });
+  }
+  std::size_t total = 0;
+  for (std::size_t t = 0; t < threads; ++t) {
+    workers[t].join();
+    total += counts[t];
+  }
+  return total;
+}
+
+int benchShared(int argc, char* argv[]) {
+  std::size_t maxThreads = 8;
+  if (argc > 0) {
+    maxThreads = std::strtoull(argv[0], nullptr, 10);
+  }
+
+  Environment constants;
+  for (std::size_t i = 0; i < 100000; ++i) {
+    constants.define("k" + std::to_string(i), Expression(i + 0.5));
+  }
+  auto shared = std::make_shared<SharedEnvironment>();
+  shared->publish(constants);
+
+  std::cout << std::setw(12) << "threads" << std::setw(16) << "evals/s"
+            << std::setw(12) << "speedup" << "   (hardware threads: "
+            << std::thread::hardware_concurrency() << ")" << std::endl;
+
+  double single = 0;
+  for (std::size_t threads = 1; threads <= maxThreads; threads *= 2) {
+    double rate = sharedEvalsPerSecond(shared, threads);
+    if (threads == 1) {
+      single = rate;
+    }
+    std::cout << std::setw(12) << threads << std::setw(16) << std::fixed << std::setprecision(0)
+              << rate << std::setw(12) << std::setprecision(2) << rate / single << std::endl;
+  }
+  return 0;
+}
+
+int benchParse(int argc, char* argv[]) {
+  std::size_t maxBytes = 100u * 1024u * 1024u;
+  if (argc > 0) {
+    maxBytes = std::strtoull(argv[0], nullptr, 10);
+  }
+
+  std::cout << std::setw(12) << "bytes" << std::setw(12) << "seconds"
+            << std::setw(12) << "ns/byte" << std::endl;
+
+  for (std::size_t bytes = 1024; bytes <= maxBytes; bytes *= 10) {
+    std::string program = programOfSize(bytes);
+    std::istringstream iss(program);
+
+    Interpreter interp;
+    Clock::time_point start = Clock::now();
+    bool ok = interp.parse(iss);
+    double seconds = secondsSince(start);
+
+    if (!ok) {
+      std::cerr << "parse failed at " << program.size() << " bytes" << std::endl;
+      return 1;
+    }
+
+    std::cout << std::setw(12) << program.size() << std::setw(12) << std::fixed
+              << std::setprecision(4) << seconds << std::setw(12)
+              << std::setprecision(1) << seconds * 1e9 / program.size() << std::endl;
+  }
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: bench_interpreter <benchmark> [args...]\n"
+              << "  parse [max_bytes]\n"
+              << "  eval [nodes]\n"
+              << "  dispatch\n"
+              << "  formulas\n"
+              << "  conjunction\n"
+              << "  defines\n"
+              << "  lookups\n"
+              << "  startup [bindings]\n"
+              << "  shared [threads]\n";
+    return 1;
+  }
+
+  std::string name = argv[1];
+  if (name == "parse") {
+    return benchParse(argc - 2, argv + 2);
+  }
+  if (name == "eval") {
+    return benchEval(argc - 2, argv + 2);
+  }
+  if (name == "dispatch") {
+    return benchDispatch();
+  }
+  if (name == "formulas") {
+    return benchFormulas();
+  }
+  if (name == "conjunction") {
+    return benchConjunction();
+  }
+  if (name == "defines") {
+    return benchDefines();
+  }
+  if (name == "lookups") {
+    return benchLookups();
+  }
+  if (name == "startup") {
+    return benchStartup(argc - 2, argv + 2);
+  }
+  if (name == "shared") {
+    return benchShared(argc - 2, argv + 2);
+  }
+
+  std::cerr << "Unknown benchmark: " << name << "\n";
+  return 1;
+}
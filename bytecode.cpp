@@ -0,0 +1,340 @@
+// Bytecode module implementation: the compiler from the Node tree and the
+// stack VM that runs the result
+#include "bytecode.hpp"
+#include "interpreter.hpp"
+#include "interpreter_semantic_error.hpp"
+
+void BytecodeProgram::clear() noexcept {
+  code.clear();
+  constants.clear();
+  messages.clear();
+  maxStack = 0;
+}
+
+void BytecodeProgram::emit(Instr instr, std::uint32_t operand) {
+  code.push_back(Instruction{instr, operand});
+}
+
+std::uint32_t BytecodeProgram::addConstant(Value value) {
+  constants.push_back(value);
+  return static_cast<std::uint32_t>(constants.size() - 1);
+}
+
+std::uint32_t BytecodeProgram::addMessage(const std::string & message) {
+  for (std::size_t i = 0; i < messages.size(); ++i) {
+    if (messages[i] == message) {
+      return static_cast<std::uint32_t>(i);
+    }
+  }
+  messages.push_back(message);
+  return static_cast<std::uint32_t>(messages.size() - 1);
+}
+
+
+// Compile the tree under root into program. Only reads the tree, so the
+// tiered backend can run it on a background thread.
+void Interpreter::compileBytecode(BytecodeProgram & program, const Node* root) const {
+  program.clear();
+  if (!root) {
+    return;
+  }
+  compileNode(program, root, 0);
+  program.emit(Instr::Return);
+}
+
+// Emit code that leaves node's value on top of a stack currently holding
+// depth values. The code mirrors evalExpr: children are evaluated left to
+// right, then the operator is applied; errors that evalExpr would raise are
+// compiled to Fail at the point where it would raise them.
+void Interpreter::compileNode(BytecodeProgram & program, const Node* node, std::size_t depth) const {
+  if (depth + 1 > program.maxStack) {
+    program.maxStack = depth + 1;
+  }
+
+  if (node->children.empty()) {
+    if (node->slot != Node::NoSlot) {
+      program.emit(Instr::Load, m_slotMap[node->slot]);
+    } else {
+      program.emit(Instr::Push, program.addConstant(node->data));
+    }
+    return;
+  }
+
+  if (!node->data.isSymbol()) {
+    program.emit(Instr::Fail, program.addMessage("Not a symbol"));
+    return;
+  }
+
+  std::size_t argc = node->children.size();
+
+  // if evaluates its condition and then only the selected branch
+  if (node->op == Opcode::If) {
+    if (argc < 3) {
+      program.emit(Instr::Fail, program.addMessage("Expected conditional"));
+      return;
+    }
+    compileNode(program, node->children[0], depth);
+    std::size_t toElse = program.code.size();
+    program.emit(Instr::JumpIfFalse);
+    compileNode(program, node->children[1], depth);
+    std::size_t toEnd = program.code.size();
+    program.emit(Instr::Jump);
+    program.code[toElse].operand = static_cast<std::uint32_t>(program.code.size());
+    compileNode(program, node->children[2], depth);
+    program.code[toEnd].operand = static_cast<std::uint32_t>(program.code.size());
+    return;
+  }
+
+  // and / or stop at the first clause that decides the result:
+  //   clause1; JumpUnless done ... clauseN; JumpUnless done
+  //   Push True; Jump end; done: Push False; end:
+  // (or uses JumpWhen and swaps the two constants)
+  if (node->op == Opcode::And || node->op == Opcode::Or) {
+    if (argc < 2) {
+      program.emit(Instr::Fail, program.addMessage("Expected bool"));
+      return;
+    }
+    bool decisive = node->op == Opcode::Or;
+    std::vector<std::size_t> exits;
+    for (const Node* child : node->children) {
+      compileNode(program, child, depth);
+      exits.push_back(program.code.size());
+      program.emit(decisive ? Instr::JumpWhen : Instr::JumpUnless);
+    }
+    program.emit(Instr::Push, program.addConstant(Value::boolean(!decisive)));
+    std::size_t toEnd = program.code.size();
+    program.emit(Instr::Jump);
+    for (std::size_t exit : exits) {
+      program.code[exit].operand = static_cast<std::uint32_t>(program.code.size());
+    }
+    program.emit(Instr::Push, program.addConstant(Value::boolean(decisive)));
+    program.code[toEnd].operand = static_cast<std::uint32_t>(program.code.size());
+    return;
+  }
+
+  for (std::size_t i = 0; i < argc; ++i) {
+    compileNode(program, node->children[i], depth + i);
+  }
+  std::uint32_t n = static_cast<std::uint32_t>(argc);
+
+  switch (node->op) {
+    case Opcode::Add:
+    case Opcode::Multiply:
+      if (argc < 2) {
+        program.emit(Instr::Fail, program.addMessage("Expected number"));
+      } else {
+        program.emit(node->op == Opcode::Add ? Instr::Add : Instr::Multiply, n);
+      }
+      return;
+
+    case Opcode::Subtract:
+      if (argc > 2) {
+        program.emit(Instr::Fail, program.addMessage("Expected number"));
+      } else {
+        program.emit(argc == 1 ? Instr::Negate : Instr::Subtract);
+      }
+      return;
+
+    case Opcode::Divide:
+    case Opcode::Less:
+    case Opcode::LessEqual:
+    case Opcode::Greater:
+    case Opcode::GreaterEqual:
+    case Opcode::Equal: {
+      if (argc != 2) {
+        program.emit(Instr::Fail, program.addMessage("Expected number"));
+        return;
+      }
+      static const Instr binary[] = {
+        Instr::Divide, Instr::Less, Instr::LessEqual, Instr::Greater,
+        Instr::GreaterEqual, Instr::Equal
+      };
+      std::size_t index = node->op == Opcode::Divide ? 0
+                        : static_cast<std::size_t>(node->op) - static_cast<std::size_t>(Opcode::Less) + 1;
+      program.emit(binary[index]);
+      return;
+    }
+
+    case Opcode::Not:
+      if (argc != 1) {
+        program.emit(Instr::Fail, program.addMessage("Expected bool"));
+      } else {
+        program.emit(Instr::Not);
+      }
+      return;
+
+    default:
+      // define, begin and unknown heads go through applyOp
+      if (depth + argc + 1 > program.maxStack) {
+        program.maxStack = depth + argc + 1;
+      }
+      program.emit(Instr::Push, program.addConstant(node->data));
+      program.emit(Instr::Call, n);
+      return;
+  }
+}
+
+
+// Computed goto needs the GNU labels-as-values extension, which -pedantic
+// reports; the switch below is the portable fallback
+#if defined(__GNUC__)
+#define SCALC_COMPUTED_GOTO 1
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+Value Interpreter::runBytecode(const BytecodeProgram & program) {
+  const Instruction* code = program.code.data();
+  const Instruction* ip = code;
+  const Value* constants = program.constants.data();
+  const Value* slots = env.slotValues();
+
+  m_vmStack.resize(program.maxStack);
+  Value* base = m_vmStack.data();
+  Value* sp = base;
+
+#ifdef SCALC_COMPUTED_GOTO
+  static void* const labels[] = {
+    &&do_Push, &&do_Load, &&do_Add, &&do_Multiply, &&do_Subtract, &&do_Negate, &&do_Divide,
+    &&do_Less, &&do_LessEqual, &&do_Greater, &&do_GreaterEqual, &&do_Equal,
+    &&do_Not, &&do_Jump, &&do_JumpIfFalse, &&do_JumpUnless, &&do_JumpWhen,
+    &&do_Call, &&do_Fail, &&do_Return
+  };
+#define VM_CASE(name) do_##name:
+#define VM_DISPATCH() goto *labels[static_cast<std::size_t>(ip->instr)]
+  VM_DISPATCH();
+#else
+#define VM_CASE(name) case Instr::name:
+#define VM_DISPATCH() continue
+  for (;;) {
+  switch (ip->instr) {
+#endif
+#define VM_NEXT() ++ip; VM_DISPATCH()
+
+  VM_CASE(Push) {
+    *sp++ = constants[ip->operand];
+    VM_NEXT();
+  }
+
+  VM_CASE(Load) {
+    *sp++ = slots[ip->operand];
+    VM_NEXT();
+  }
+
+  VM_CASE(Add) {
+    Value* args = sp - ip->operand;
+    double sum = 0;
+    for (Value* arg = args; arg != sp; ++arg) {
+      sum += numberValue(*arg);
+    }
+    sp = args;
+    *sp++ = Value::number(sum);
+    VM_NEXT();
+  }
+
+  VM_CASE(Multiply) {
+    Value* args = sp - ip->operand;
+    double product = 1;
+    for (Value* arg = args; arg != sp; ++arg) {
+      product = product * numberValue(*arg);
+    }
+    sp = args;
+    *sp++ = Value::number(product);
+    VM_NEXT();
+  }
+
+  VM_CASE(Subtract) {
+    double left = numberValue(sp[-2]);
+    double right = numberValue(sp[-1]);
+    sp -= 2;
+    *sp++ = Value::number(left - right);
+    VM_NEXT();
+  }
+
+  VM_CASE(Negate) {
+    sp[-1] = Value::number(-numberValue(sp[-1]));
+    VM_NEXT();
+  }
+
+#define VM_BINARY(name, make, expr)                \
+  VM_CASE(name) {                                  \
+    double left = numberValue(sp[-2]);             \
+    double right = numberValue(sp[-1]);            \
+    sp -= 2;                                       \
+    *sp++ = Value::make(expr);                     \
+    VM_NEXT();                                     \
+  }
+
+  VM_BINARY(Divide, number, left / right)
+  VM_BINARY(Less, boolean, left < right)
+  VM_BINARY(LessEqual, boolean, left <= right)
+  VM_BINARY(Greater, boolean, left > right)
+  VM_BINARY(GreaterEqual, boolean, left >= right)
+  VM_BINARY(Equal, boolean, left == right)
+#undef VM_BINARY
+
+  VM_CASE(Not) {
+    sp[-1] = Value::boolean(!boolValue(sp[-1]));
+    VM_NEXT();
+  }
+
+  VM_CASE(Jump) {
+    ip = code + ip->operand;
+    VM_DISPATCH();
+  }
+
+  VM_CASE(JumpIfFalse) {
+    Value test = *--sp;
+    if (!test.isBool()) {
+      throw InterpreterSemanticError("Not a boolean");
+    }
+    ip = test.asBool() ? ip + 1 : code + ip->operand;
+    VM_DISPATCH();
+  }
+
+  VM_CASE(JumpUnless) {
+    ip = boolValue(*--sp) ? ip + 1 : code + ip->operand;
+    VM_DISPATCH();
+  }
+
+  VM_CASE(JumpWhen) {
+    ip = boolValue(*--sp) ? code + ip->operand : ip + 1;
+    VM_DISPATCH();
+  }
+
+  VM_CASE(Call) {
+    SymbolId head = sp[-1].asSymbol();
+    Value* args = sp - 1 - ip->operand;
+    std::vector<Expression> expressions;
+    expressions.reserve(ip->operand);
+    for (Value* arg = args; arg != sp - 1; ++arg) {
+      expressions.push_back(toExpression(*arg));
+    }
+    Value result = toValue(applyOp(opcodeFor(head), head,
+                                   ArgList<Expression>{expressions.data(), expressions.size()}));
+    sp = args;
+    *sp++ = result;
+    VM_NEXT();
+  }
+
+  VM_CASE(Fail) {
+    throw InterpreterSemanticError(program.messages[ip->operand]);
+  }
+
+  VM_CASE(Return) {
+    return sp[-1];
+  }
+
+#ifndef SCALC_COMPUTED_GOTO
+  }
+  }
+#endif
+#undef VM_CASE
+#undef VM_NEXT
+#undef VM_DISPATCH
+}
+
+#ifdef SCALC_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#undef SCALC_COMPUTED_GOTO
+#endif
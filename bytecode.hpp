@@ -0,0 +1,57 @@
+// Bytecode module declarations
+#ifndef BYTECODE_HPP
+#define BYTECODE_HPP
+
+// system includes
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// module includes
+#include "value.hpp"
+
+// Instructions of the stack VM. Operands are constant, message or
+// argument counts as noted; n-ary instructions pop their n arguments and
+// push one result.
+enum class Instr : std::uint8_t {
+  Push,         // push constants[operand]
+  Load,         // push environment slot operand (see Environment::resolve)
+  Add,          // n-ary +
+  Multiply,     // n-ary *
+  Subtract,     // binary -
+  Negate,       // unary -
+  Divide,
+  Less, LessEqual, Greater, GreaterEqual, Equal,
+  Not,
+  Jump,         // continue at code[operand]
+  JumpIfFalse,  // pop a boolean; continue at code[operand] if it is false
+  JumpUnless,   // pop a boolean, or a symbol bound to one; continue at
+                // code[operand] if it is false
+  JumpWhen,     // the same, continuing at code[operand] if it is true
+  Call,         // pop the head symbol and operand arguments, apply through applyOp
+  Fail,         // throw InterpreterSemanticError(messages[operand])
+  Return        // the top of the stack is the program's result
+};
+
+struct Instruction {
+  Instr instr;
+  std::uint32_t operand;
+};
+
+// A program compiled for the stack VM
+class BytecodeProgram {
+public:
+  std::vector<Instruction> code;
+  std::vector<Value> constants;
+  std::vector<std::string> messages;
+  std::size_t maxStack = 0;
+
+  bool empty() const noexcept { return code.empty(); }
+  void clear() noexcept;
+
+  void emit(Instr instr, std::uint32_t operand = 0);
+  std::uint32_t addConstant(Value value);
+  std::uint32_t addMessage(const std::string & message);
+};
+
+#endif
@@ -1,3 +1,225 @@
+// Environment module implementation: the binary image format
 #include "environment.hpp"
 
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <sstream>
 
+// An image is, in native byte order:
+//   Header
+//   header.names times: std::uint32_t length, then length bytes of name
+//   header.bindings times: Record
+// Bound names and symbol values refer to names by their index, so every
+// name is interned once on load.
+namespace {
+
+const char Magic[4] = {'S', 'E', 'N', 'V'};
+const std::uint32_t Version = 1;
+
+struct Header {
+  char magic[4];
+  std::uint32_t version; // also tells a reader of the other byte order apart
+  std::uint32_t names;
+  std::uint32_t bindings;
+};
+
+enum : std::uint32_t { NumberRecord, BoolRecord, SymbolRecord };
+
+struct Record {
+  std::uint32_t name;
+  std::uint32_t type;
+  std::uint64_t payload; // bits of the number, 0 or 1, or a name index
+};
+
+[[noreturn]] void fail(const std::string & message) {
+  throw InterpreterSemanticError("Snapshot error: " + message);
+}
+
+template <typename T>
+void append(std::string & image, const T & item) {
+  image.append(reinterpret_cast<const char*>(&item), sizeof(item));
+}
+
+// Bounds-checked cursor over the image
+class Reader {
+public:
+  Reader(const char* data, std::size_t size) : m_at(data), m_end(data + size) {}
+
+  std::size_t remaining() const { return static_cast<std::size_t>(m_end - m_at); }
+
+  const char* take(std::size_t size) {
+    if (size > remaining()) {
+      fail("truncated image");
+    }
+    const char* at = m_at;
+    m_at += size;
+    return at;
+  }
+
+  template <typename T>
+  T read() {
+    T item;
+    std::memcpy(&item, take(sizeof(item)), sizeof(item));
+    return item;
+  }
+
+private:
+  const char* m_at;
+  const char* m_end;
+};
+
+}
+
+Environment Environment::flattened() const {
+  Environment flat;
+  if (!m_parent) {
+    flat.symbols = symbols;
+    return flat;
+  }
+  // Innermost first, so a binding found is never overwritten
+  for (const Environment* layer = this; layer; layer = layer->m_parent.get()) {
+    layer->symbols.forEach([&flat](SymbolId id, const Expression& value) {
+      if (!flat.symbols.find(id)) {
+        flat.symbols.assign(id, value);
+      }
+    });
+  }
+  return flat;
+}
+
+void Environment::rebase(const Environment* base, EnvironmentSnapshot to) {
+  for (const Environment* layer = m_parent.get(); layer && layer != base;
+       layer = layer->m_parent.get()) {
+    layer->symbols.forEach([this](SymbolId id, const Expression& value) {
+      if (!symbols.find(id)) {
+        symbols.assign(id, value);
+      }
+    });
+  }
+  m_parent = std::move(to);
+  for (const auto& slot : m_slots) {
+    m_slotValues[slot.second] = operand(slot.first);
+  }
+}
+
+void Environment::save(std::ostream& out) const {
+  SymbolMap visible = flattened().symbols;
+
+  std::vector<SymbolId> names;
+  std::unordered_map<SymbolId, std::uint32_t> indices;
+  auto nameIndex = [&names, &indices](SymbolId id) {
+    auto found = indices.emplace(id, static_cast<std::uint32_t>(names.size()));
+    if (found.second) {
+      names.push_back(id);
+    }
+    return found.first->second;
+  };
+
+  std::vector<Record> records;
+  records.reserve(visible.size());
+  visible.forEach([&](SymbolId id, const Expression& value) {
+    Record record;
+    record.name = nameIndex(id);
+    if (value.isNumber()) {
+      double number = value.getNumber();
+      record.type = NumberRecord;
+      std::memcpy(&record.payload, &number, sizeof(number));
+    } else if (value.isBool()) {
+      record.type = BoolRecord;
+      record.payload = value.getBool() ? 1 : 0;
+    } else if (value.isSymbol()) {
+      record.type = SymbolRecord;
+      record.payload = nameIndex(value.getSymbolId());
+    } else {
+      fail("cannot save the binding of " + symbolName(id));
+    }
+    records.push_back(record);
+  });
+
+  Header header;
+  std::memcpy(header.magic, Magic, sizeof(Magic));
+  header.version = Version;
+  header.names = static_cast<std::uint32_t>(names.size());
+  header.bindings = static_cast<std::uint32_t>(records.size());
+
+  std::string image;
+  append(image, header);
+  for (SymbolId id : names) {
+    const std::string& name = symbolName(id);
+    append(image, static_cast<std::uint32_t>(name.size()));
+    image += name;
+  }
+  image.append(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+
+  out.write(image.data(), static_cast<std::streamsize>(image.size()));
+  if (!out) {
+    fail("write failed");
+  }
+}
+
+Environment Environment::load(const char* data, std::size_t size) {
+  Reader reader(data, size);
+  Header header = reader.read<Header>();
+  if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0) {
+    fail("not an environment image");
+  }
+  if (header.version != Version) {
+    fail("unsupported image version");
+  }
+  // Every name takes at least its length, so a corrupt count cannot
+  // make the vector below huge
+  if (header.names > reader.remaining() / sizeof(std::uint32_t)) {
+    fail("truncated image");
+  }
+
+  std::vector<SymbolId> ids;
+  ids.reserve(header.names);
+  for (std::uint32_t i = 0; i < header.names; ++i) {
+    std::uint32_t length = reader.read<std::uint32_t>();
+    const char* name = reader.take(length);
+    ids.push_back(intern(std::string(name, length)));
+  }
+  if (reader.remaining() != std::size_t(header.bindings) * sizeof(Record)) {
+    fail("truncated image");
+  }
+
+  Environment env;
+  env.symbols.reserve(header.bindings);
+  for (std::uint32_t i = 0; i < header.bindings; ++i) {
+    Record record = reader.read<Record>();
+    if (record.name >= ids.size()) {
+      fail("name index out of range");
+    }
+    switch (record.type) {
+      case NumberRecord: {
+        double number;
+        std::memcpy(&number, &record.payload, sizeof(number));
+        env.symbols.assign(ids[record.name], Expression(number));
+        break;
+      }
+      case BoolRecord:
+        env.symbols.assign(ids[record.name], Expression(record.payload != 0));
+        break;
+      case SymbolRecord:
+        if (record.payload >= ids.size()) {
+          fail("name index out of range");
+        }
+        env.symbols.assign(ids[record.name], Expression::fromSymbol(ids[record.payload]));
+        break;
+      default:
+        fail("unknown value type");
+    }
+  }
+  return env;
+}
+
+Environment Environment::load(std::istream& in) {
+  std::ostringstream image;
+  image << in.rdbuf();
+  if (in.bad()) {
+    fail("read failed");
+  }
+  std::string bytes = image.str();
+  return load(bytes.data(), bytes.size());
+}
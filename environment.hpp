@@ -2,29 +2,193 @@
 #define ENVIRONMENT_HPP
 
 // Standard library includes
-#include <string>     // for std::string
-#include <map>        // for std::map
-#include <stdexcept>  // optional, if InterpreterSemanticError inherits from std::runtime_error
+#include <atomic>         // for std::atomic_thread_fence
+#include <cstddef>        // for std::size_t
+#include <cstdint>        // for std::uint32_t
+#include <iosfwd>         // for std::istream, std::ostream
+#include <memory>         // for std::shared_ptr
+#include <string>         // for std::string
+#include <unordered_map>  // for std::unordered_map
+#include <utility>        // for std::move
+#include <vector>         // for std::vector
+#include <stdexcept>      // optional, if InterpreterSemanticError inherits from std::runtime_error
 
 // Project includes
 #include "expression.hpp"
+#include "symbol_map.hpp"
+#include "symbol_table.hpp"
+#include "value.hpp"
 #include "interpreter_semantic_error.hpp"  // defines InterpreterSemanticError
 
+class Environment;
+
+// Frozen environment, shared by every environment forked from it
+typedef std::shared_ptr<const Environment> EnvironmentSnapshot;
+
+// Symbol bindings, persistent across snapshots. An environment is a layer
+// of its own bindings over an optional parent snapshot: forking a snapshot
+// is O(1), and bindings made in a fork shadow the parent's without copying
+// them. Lookups that miss a layer continue in its parent; snapshot() keeps
+// the number of layers logarithmic in the number of bindings.
 class Environment {
 public:
-    std::map<std::string, Expression> symbols;
+    Environment() = default;
+    Environment(const Environment&) = default;
+    Environment(Environment&&) = default;
+    Environment& operator=(const Environment&) = default;
+    Environment& operator=(Environment&&) = default;
+
+    // Parents no other environment holds are released one by one, so a
+    // long chain of layers cannot overflow the stack
+    ~Environment() {
+        EnvironmentSnapshot parent = std::move(m_parent);
+        while (parent && parent.use_count() == 1) {
+            // use_count() is a relaxed load: the fence pairs it with the
+            // release decrements of the former owners, so whatever they
+            // did to the layer happens before it is torn down here
+            std::atomic_thread_fence(std::memory_order_acquire);
+            EnvironmentSnapshot next = std::move(parent->m_parent);
+            parent = std::move(next);
+        }
+    }
+
+    // A fork of snapshot: every binding of snapshot is visible, and new
+    // ones are made in this environment only
+    explicit Environment(EnvironmentSnapshot snapshot) : m_parent(std::move(snapshot)) {}
+
+    // Bindings made in this layer, keyed by interned symbol id
+    SymbolMap symbols;
+
+    void define(SymbolId id, const Expression& value) {
+        symbols.assign(id, value);
+        auto slot = m_slots.find(id);
+        if (slot != m_slots.end()) {
+            m_slotValues[slot->second] = operand(id);
+        }
+    }
 
     void define(const std::string& name, const Expression& value) {
-        symbols[name] = value;
+        define(intern(name), value);
+    }
+
+    // The value bound to id, or nullptr when id is unbound. Never throws,
+    // so the evaluator can test a binding without building an error.
+    const Expression* lookup(SymbolId id) const noexcept {
+        for (const Environment* layer = this; layer; layer = layer->m_parent.get()) {
+            const Expression* value = layer->symbols.find(id);
+            if (value) {
+                return value;
+            }
+        }
+        return nullptr;
+    }
+
+    Expression get(SymbolId id) const {
+        const Expression* value = lookup(id);
+        if (!value) {
+            throw InterpreterSemanticError("Undefined symbol: " + symbolName(id));
+        }
+        return *value;
     }
 
     Expression get(const std::string& name) const {
-        auto it = symbols.find(name);
-        if (it == symbols.end()) {
-            throw InterpreterSemanticError("Undefined symbol: " + name);
+        return get(intern(name));
+    }
+
+    // Freeze the bindings made so far: they move to a new snapshot, which
+    // becomes this environment's parent. The new layer absorbs copies of
+    // parent layers up to twice its size, so each layer is more than twice
+    // the size of the one before it: there are at most log2(bindings) + 1
+    // layers, and each binding is copied O(log bindings) times in all.
+    EnvironmentSnapshot snapshot() {
+        if (symbols.empty() && m_parent) {
+            return m_parent;
         }
-        return it->second;
+        SymbolMap layer = std::move(symbols);
+        EnvironmentSnapshot below = m_parent;
+        while (below && below->symbols.size() <= 2 * layer.size()) {
+            SymbolMap merged = below->symbols;
+            layer.forEach([&merged](SymbolId id, const Expression& value) {
+                merged.assign(id, value);
+            });
+            layer = std::move(merged);
+            below = below->m_parent;
+        }
+        std::shared_ptr<Environment> frozen = std::make_shared<Environment>(std::move(below));
+        frozen->symbols = std::move(layer);
+        m_parent = frozen;
+        return m_parent;
+    }
+
+    // The snapshot this environment was forked from, if any
+    const EnvironmentSnapshot & parent() const noexcept { return m_parent; }
+
+    // Number of layers: this one and those of its parent snapshots
+    std::size_t depth() const noexcept {
+        std::size_t layers = 0;
+        for (const Environment* layer = this; layer; layer = layer->m_parent.get()) {
+            ++layers;
+        }
+        return layers;
     }
+
+    // Every binding visible here, collected into one layer with no parent
+    Environment flattened() const;
+
+    // Move this environment from base onto snapshot to: bindings of its
+    // layers above base are gathered into its own layer, which then lies
+    // directly over to. Slots keep their numbers and are refilled from
+    // the new bindings, so code compiled against them stays valid.
+    void rebase(const Environment* base, EnvironmentSnapshot to);
+
+    // Binary image of every binding visible here, in all layers, for
+    // load() to restore without evaluating the definitions again. Names
+    // are stored as text, so an image can be loaded by another process.
+    // Throws InterpreterSemanticError if a binding is not a number,
+    // boolean or symbol, or the write fails.
+    void save(std::ostream& out) const;
+
+    // Environment holding the bindings of an image written by save(),
+    // read with one pass over the bytes. Throws InterpreterSemanticError
+    // if the image is truncated, corrupt or of another format version.
+    static Environment load(const char* data, std::size_t size);
+    static Environment load(std::istream& in);
+
+    // Lexical addressing. resolve() gives a symbol a fixed slot, the same
+    // one on every call. A slot holds what an operator reading the symbol
+    // as an argument needs: its number or boolean once it is bound to one,
+    // and otherwise the symbol itself, to be looked up by name.
+    std::uint32_t resolve(SymbolId id) {
+        auto slot = m_slots.find(id);
+        if (slot != m_slots.end()) {
+            return slot->second;
+        }
+        std::uint32_t index = static_cast<std::uint32_t>(m_slotValues.size());
+        m_slots.emplace(id, index);
+        m_slotValues.push_back(operand(id));
+        return index;
+    }
+
+    // Slot contents, indexed by the values resolve() returned. The array
+    // only grows in resolve().
+    const Value* slotValues() const noexcept { return m_slotValues.data(); }
+
+private:
+    Value operand(SymbolId id) const {
+        const Expression* value = lookup(id);
+        if (value && (value->isNumber() || value->isBool())) {
+            return toValue(*value);
+        }
+        return Value::symbol(id);
+    }
+
+    // mutable so that the destructor of a child can take it over. That
+    // happens only once the child's reference is the last one: no other
+    // thread can then reach the layer, let alone read m_parent, and the
+    // acquire fence makes every earlier access by former owners visible.
+    mutable EnvironmentSnapshot m_parent;
+    std::unordered_map<SymbolId, std::uint32_t> m_slots;
+    std::vector<Value> m_slotValues;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -3,29 +3,98 @@
 #include "expression.hpp"
 #include "interpreter_semantic_error.hpp"
 
+#include <cstring>
+#include <utility>
+
+static_assert(sizeof(Expression) <= 16, "Expression should stay a 16 byte tagged union");
 
 // Default constructor: type is None
-Expression::Expression() : m_type(ExpressionType::None) {}
+Expression::Expression() noexcept : m_type(ExpressionType::None), m_numberValue(0) {}
 
 // Boolean constructor
-Expression::Expression(bool tf) 
-  : m_type(ExpressionType::Boolean), m_boolValue(tf) {}
+Expression::Expression(bool tf) noexcept
+  : m_type(ExpressionType::Boolean), m_numberValue(0) {
+  m_boolValue = tf;
+}
 
 // Number constructor
-Expression::Expression(double num) 
+Expression::Expression(double num) noexcept
   : m_type(ExpressionType::Number), m_numberValue(num) {}
 
 // Symbol constructor
-Expression::Expression(const std::string & sym) 
-  : m_type(ExpressionType::Symbol), m_symbolValue(sym) {}
+Expression::Expression(const std::string & sym)
+  : m_type(ExpressionType::Symbol), m_numberValue(0) {
+  m_symbolValue = intern(sym);
+}
+
+Expression Expression::fromSymbol(SymbolId id) noexcept {
+  Expression expr;
+  expr.m_type = ExpressionType::Symbol;
+  expr.m_symbolValue = id;
+  return expr;
+}
+
+Expression::Expression(const Expression & other) : m_type(ExpressionType::None) {
+  copyFrom(other);
+}
+
+Expression::Expression(Expression && other) noexcept : m_type(other.m_type) {
+  // Steal any heap payload; other is left as None
+  std::memcpy(&m_numberValue, &other.m_numberValue, sizeof(m_numberValue));
+  other.m_type = ExpressionType::None;
+}
+
+Expression & Expression::operator=(const Expression & other) {
+  if (this != &other) {
+    Expression copy(other);
+    *this = std::move(copy);
+  }
+  return *this;
+}
+
+Expression & Expression::operator=(Expression && other) noexcept {
+  if (this != &other) {
+    destroy();
+    m_type = other.m_type;
+    std::memcpy(&m_numberValue, &other.m_numberValue, sizeof(m_numberValue));
+    other.m_type = ExpressionType::None;
+  }
+  return *this;
+}
+
+Expression::~Expression() {
+  destroy();
+}
+
+// Free the heap payload of a list
+void Expression::destroy() noexcept {
+  if (m_type == ExpressionType::List) {
+    delete m_args;
+  }
+  m_type = ExpressionType::None;
+}
+
+// Copy other into this, which holds no heap payload
+void Expression::copyFrom(const Expression & other) {
+  switch (other.m_type) {
+    case ExpressionType::List:
+      m_args = new std::vector<Expression>(*other.m_args);
+      break;
+    default:
+      std::memcpy(&m_numberValue, &other.m_numberValue, sizeof(m_numberValue));
+      break;
+  }
+  m_type = other.m_type;
+}
 
-// Add an argument to a compound expression 
+// Add an argument to a compound expression
 void Expression::addArgument(const Expression & arg) {
   if (m_type != ExpressionType::List) {
+    destroy();                                     // drop any previous value
+    m_args = new std::vector<Expression>();
     m_type = ExpressionType::List; // prmote it to a list if needed
-    m_args.clear();                // clear any previous value
   }
-  m_args.push_back(arg);
+  m_args->push_back(arg);
 }
 
 
@@ -36,9 +105,14 @@ ExpressionType Expression::type() const {
   return m_type;
 }
 
-// Return arguments 4 lists
+// Return arguments 4 lists; an empty expression becomes an empty list
 std::vector<Expression> & Expression::getArgs(){
-  return m_args;
+  if (m_type == ExpressionType::None) {
+    m_args = new std::vector<Expression>();
+    m_type = ExpressionType::List;
+  }
+  if (m_type != ExpressionType::List) throw InterpreterSemanticError("Not a list");
+  return *m_args;
 }
 
 // Comparison operator
@@ -75,6 +149,11 @@ bool Expression::getBool() const {
 }
 
 std::string Expression::getSymbol() const {
+  if (!isSymbol()) throw InterpreterSemanticError("Not a symbol");
+  return symbolName(m_symbolValue);
+}
+
+SymbolId Expression::getSymbolId() const {
   if (!isSymbol()) throw InterpreterSemanticError("Not a symbol");
   return m_symbolValue;
 }
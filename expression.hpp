@@ -6,14 +6,30 @@
 #include <string>
 #include <vector>
 
+// module includes
+#include "symbol_table.hpp"
+
 enum class ExpressionType { None, Boolean, Number, Symbol, List };
 
+// Tagged union: only the payload selected by the type is stored. Booleans,
+// numbers and interned symbol ids are held inline (16 bytes in total);
+// list arguments live on the heap and are owned by the Expression.
 class Expression{
 public:
-  Expression();
-  Expression(bool tf);
-  Expression(double num);
+  Expression() noexcept;
+  Expression(bool tf) noexcept;
+  Expression(double num) noexcept;
   Expression(const std::string & sym);
+
+  // Symbol expression for an already interned id
+  static Expression fromSymbol(SymbolId id) noexcept;
+
+  Expression(const Expression & other);
+  Expression(Expression && other) noexcept;
+  Expression & operator=(const Expression & other);
+  Expression & operator=(Expression && other) noexcept;
+  ~Expression();
+
   bool operator==(const Expression & exp) const noexcept;
 
   //MY ADDITION
@@ -25,31 +41,30 @@ public:
     bool isNumber() const noexcept;
     bool isBool() const noexcept;
     bool isSymbol() const noexcept;
-  
+
     // Optionally: getters
     double getNumber() const;
     bool getBool() const;
     std::string getSymbol() const;
-    std::vector<int> heads;
+    SymbolId getSymbolId() const;
     ExpressionType getType() const;
 
 
 private:
-  // DEFAULT
-  // bool tempb;
-  // double tempd;
-  // std::string temps;
+  void destroy() noexcept;
+  void copyFrom(const Expression & other);
 
-  //MINE
   ExpressionType m_type;
-  bool m_boolValue;
-  double m_numberValue;
-  std::string m_symbolValue;
-  std::vector<Expression> m_args;
+  union {
+    bool m_boolValue;
+    double m_numberValue;
+    SymbolId m_symbolValue;
+    std::vector<Expression>* m_args;
+  };
 
   friend class Interpreter;
 
 };
 
 
-#endif
\ No newline at end of file
+#endif
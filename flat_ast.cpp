@@ -0,0 +1,23 @@
+// Flat AST module implementation
+#include "flat_ast.hpp"
+
+void FlatAST::clear() noexcept {
+  opcodes.clear();
+  values.clear();
+  firstChild.clear();
+  childCount.clear();
+}
+
+std::uint32_t FlatAST::addNode(Value atom, Opcode op) {
+  std::uint32_t index = static_cast<std::uint32_t>(values.size());
+  opcodes.push_back(op);
+  values.push_back(atom);
+  firstChild.push_back(0);
+  childCount.push_back(0);
+  return index;
+}
+
+void FlatAST::setChildren(std::uint32_t node, std::uint32_t first, std::uint32_t count) {
+  firstChild[node] = first;
+  childCount[node] = count;
+}
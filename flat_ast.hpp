@@ -0,0 +1,36 @@
+// Flat AST module declarations
+#ifndef FLAT_AST_HPP
+#define FLAT_AST_HPP
+
+// system includes
+#include <cstdint>
+#include <vector>
+
+// module includes
+#include "opcode.hpp"
+#include "value.hpp"
+
+// An AST stored as parallel arrays indexed by node number. Nodes are laid
+// out breadth first, so the children of node i are the childCount[i]
+// consecutive nodes starting at firstChild[i]. The root is node 0.
+//
+// Each node's atom is a NaN-boxed Value; symbols are interned ids. The
+// opcode a symbol names is resolved when the node is added.
+class FlatAST {
+public:
+  std::vector<Opcode> opcodes;
+  std::vector<Value> values;
+  std::vector<std::uint32_t> firstChild;
+  std::vector<std::uint32_t> childCount;
+
+  bool empty() const noexcept { return values.empty(); }
+  std::size_t size() const noexcept { return values.size(); }
+  void clear() noexcept;
+
+  // Append a node holding an atom; its children are attached with
+  // setChildren once they have been appended
+  std::uint32_t addNode(Value atom, Opcode op);
+  void setChildren(std::uint32_t node, std::uint32_t first, std::uint32_t count);
+};
+
+#endif
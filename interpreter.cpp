@@ -2,917 +2,656 @@
 #include "interpreter.hpp"
 #include "environment.hpp"
 #include "interpreter_semantic_error.hpp"
-#include <cctype>
 #include <stdexcept>
 #include <iostream>
 #include <cmath>
 #include <algorithm>
-#include <unordered_set>
+#include <memory>
+#include <system_error>
 
 
-std::vector<std::string> Interpreter::tokenize(const std::string & str) const {
-  std::vector<std::string> tokens;
-  std::string token;
-  bool inComment = false;
+// Map the program's slot numbers onto slots of this environment. Other
+// symbols keep their identity and are looked up by name.
+void Interpreter::resolveSlots() {
+  const std::vector<SymbolId> & symbols = m_program->slotSymbols();
+  m_slotMap.resize(symbols.size());
+  for (std::size_t i = 0; i < symbols.size(); ++i) {
+    m_slotMap[i] = env.resolve(symbols[i]);
+  }
+}
 
-  for (char ch : str) {
-    if (ch == '\n') {
-      inComment = false; // end of comment
-    }
+// Value of a leaf: its atom, or for a symbol with a slot what the slot holds
+Expression Interpreter::leafValue(const Node* leaf) const {
+  if (leaf->slot != Node::NoSlot) {
+    return toExpression(env.slotValues()[m_slotMap[leaf->slot]]);
+  }
+  return toExpression(leaf->data);
+}
 
-    if (inComment) {
-      continue; // skip characters in comment
-    }
+Interpreter::~Interpreter() {
+  stopTiering();
+}
 
-    if (ch == ';') {
-      inComment = true; // start skipping
-      continue;
-    }
+bool Interpreter::parse(std::istream & input) noexcept {
+  try {
+    load(Program::parse(input));
+  } catch (...) {
+    load(nullptr);
+  }
+  return m_program != nullptr;
+}
 
-    if (isspace(ch)) {
-      if (!token.empty()) {
-        tokens.push_back(token);
-        token.clear();
-      }
-    } else if (ch == '(' || ch == ')') {
-      if (!token.empty()) {
-        tokens.push_back(token);
-        token.clear();
-      }
-      tokens.push_back(std::string(1, ch));
-    } else {
-      token += ch;
-    }
+void Interpreter::load(std::shared_ptr<const Program> program) {
+  dropCompiled();
+  m_program = std::move(program);
+  ASTroot = m_program ? m_program->root() : nullptr;
+  m_slotMap.clear();
+  if (m_program) {
+    resolveSlots();
   }
+}
 
-  if (!token.empty()) {
-    tokens.push_back(token);
+void Interpreter::fork(EnvironmentSnapshot snapshot) {
+  // Slots are numbered per environment, so the program is resolved again
+  dropCompiled();
+  env = Environment(std::move(snapshot));
+  m_shared = nullptr;
+  m_sharedBase = nullptr;
+  if (m_program) {
+    resolveSlots();
   }
+}
 
-  return tokens;
+void Interpreter::share(std::shared_ptr<const SharedEnvironment> shared) {
+  std::uint64_t version = 0;
+  EnvironmentSnapshot base = shared->current(&version);
+  fork(base);
+  m_shared = std::move(shared);
+  m_sharedBase = std::move(base);
+  m_sharedVersion = version;
 }
 
-// Recursive parser from token list to Expression tree
-Expression Interpreter::buildAST(std::vector<std::string> & tokens) {
-  if (tokens.empty()) {
-    throw InterpreterSemanticError("Unexpected EOF while reading");
-  }
+// Forget every form compiled from the current tree and environment
+void Interpreter::dropCompiled() noexcept {
+  stopTiering();
+  m_flat.clear();
+  m_bytecode.clear();
+  m_jit.clear();
+  m_jitTried = false;
+}
 
+Expression Interpreter::eval() {
+  if (m_shared && m_shared->version() != m_sharedVersion) {
+    EnvironmentSnapshot base = m_shared->current(&m_sharedVersion);
+    env.rebase(m_sharedBase.get(), base);
+    m_sharedBase = std::move(base);
+  }
 
-  std::string token = tokens.front();
-  tokens.erase(tokens.begin());
+  if (!ASTroot) {
+    throw InterpreterSemanticError("Evaluation error: no program parsed");
+  }
 
-  if (token == "(" && tokens.size() == m_og_size - 1) {
-    Expression expr; // empty list by default
-    while (tokens.size() != 1) {
-      expr.addArgument(buildAST(tokens));
-  
-    }
+  ++m_evalCount;
 
-    if (tokens.empty() || tokens.front() != ")") {
-      throw InterpreterSemanticError("Expected ')'");
-    }
-    tokens.erase(tokens.begin()); // discard ")"
+  // Programs too deep for the recursive compilers stay on the tree walker
+  Backend backend = m_backend;
+  if (m_program->depth() > MaxCompileDepth && backend != Backend::FlatAST) {
+    backend = Backend::TreeWalker;
+  }
 
-     //Reject empty expressions like ( )
-      if (expr.getArgs().empty()) {
-      throw InterpreterSemanticError("Empty expression is invalid");
+  try {
+    if (backend == Backend::Tiered) {
+      const BytecodeProgram* hot = m_promoted.load(std::memory_order_acquire);
+      if (hot) {
+        return toExpression(runBytecode(*hot));
+      }
+      if (!m_tierStarted && m_evalCount >= m_tierThreshold) {
+        tierUp();
       }
-    return expr;
-  }
-  // else if (token == ")") {
-  //   throw std::runtime_error("Unexpected ')'");
-  // } 
-  else {
-    // Atom: number, boolean, or symbol
-    if (token == "True") return Expression(true);
-    if (token == "False") return Expression(false);
-
-    if (token == "pi")
-    {
-      Expression expr = Expression(std::atan2(0, -1));
-      expr.m_symbolValue = "pi";
-      return expr;
+      return evalExpr(ASTroot);
     }
-
-    if (isValidSymbol(token)) {
-      return Expression(token);
+    if (backend == Backend::FlatAST) {
+      if (m_flat.empty()) {
+        buildFlat();
+      }
+      return toExpression(evalFlat(0));
     }
-    if(token == "(" || token == ")"){
-      //tokens.erase(tokens.begin());
-      return Expression(token);
+    if (backend == Backend::Bytecode) {
+      if (m_bytecode.empty()) {
+        compileBytecode(m_bytecode, ASTroot);
+      }
+      return toExpression(runBytecode(m_bytecode));
     }
-
-    
-
-
-    try {
-      std::size_t idx;
-      std::string token_temp  = token;
-      double number = std::stod(token_temp, &idx);
-      if(idx < token.length()){
-        if (isValidSymbol(token)) {
-          return Expression(token);
-        } else {
-          throw InterpreterSemanticError("Invalid token: " + token);
-        }
-      }      
-      return Expression(number);
-    } catch (...) {
-      if (isValidSymbol(token)) {
-        return Expression(token);
-      } else {
-        throw InterpreterSemanticError("Invalid token: " + token);
+    if (backend == Backend::Jit) {
+      if (!m_jitTried) {
+        m_jitTried = true;
+        compileJit();
+      }
+      Expression result;
+      if (runJit(result)) {
+        return result;
       }
     }
+    return evalExpr(ASTroot);
+  } catch (const InterpreterSemanticError & err) {
+    std::cerr << "Evaluation error: " << err.what() << std::endl;
+    throw InterpreterSemanticError("Evaluation error ");
   }
 }
 
-bool Interpreter::isValidSymbol(const std::string & token) {
-  static const std::unordered_set<std::string> specialForms = {
-    "not", "and", "or", "<", "<=", ">", ">=", "=", "+", "-", "*", "/", "define", "begin", "if"
-  };
 
-  // Rule 4: Not a reserved keyword or special form
-  if (specialForms.count(token)) {
-    return true;
+// Start compiling the current program to bytecode on a background thread.
+// The compiler only reads the Node tree, which stays unchanged until the
+// next parse() joins the thread. If no thread can be started the program
+// stays on the tree walker.
+void Interpreter::tierUp() {
+  m_tierStarted = true;
+  const Node* root = ASTroot;
+  try {
+    m_compiler = std::thread([this, root]() {
+      try {
+        std::unique_ptr<BytecodeProgram> program(new BytecodeProgram);
+        compileBytecode(*program, root);
+        m_promoted.store(program.release(), std::memory_order_release);
+      } catch (...) {
+        // no faster tier for this program
+      }
+    });
+  } catch (const std::system_error &) {
   }
+}
 
-  // Rule 1: No whitespace
-  if (token.find_first_of(" \t\n\r") != std::string::npos) {
-    return false;
+// Wait for any background compile and drop the current program's tiers
+void Interpreter::stopTiering() noexcept {
+  if (m_compiler.joinable()) {
+    m_compiler.join();
   }
+  delete m_promoted.exchange(nullptr, std::memory_order_acq_rel);
+  m_evalCount = 0;
+  m_tierStarted = false;
+}
 
-  // Rule 3: Must not start with a digit
-  if (!token.empty() && std::isdigit(token[0])) {
-    return false;
-  }
 
-  // Rule 2: Must not be parseable as a number
-  char* endptr = nullptr;
-  std::strtod(token.c_str(), &endptr);
-  if (*endptr == '\0') {
-    // Entire token was parsed as a valid number
-    return false;
-  }
+// Post-order evaluation on explicit work stacks: m_frames holds the
+// operators whose arguments are being evaluated and m_values the results
+// of the finished ones, so nesting depth is limited by the heap rather
+// than the native stack. Not reentrant; both stacks are reset per call.
+Expression Interpreter::evalExpr(Node* ASTrootnode) {
+m_frames.clear();
+m_values.clear();
+
+Node* node = ASTrootnode;
+for (;;) {
+  // Start node: a leaf is its own value, an operator gets a frame
+  if (node->children.empty()) { //Empty node then return the data
+    m_values.push_back(leafValue(node));
+  } else {
+    if (!node->data.isSymbol()) {
+      throw InterpreterSemanticError("Not a symbol");
+    }
+    if (node->op == Opcode::If && node->children.size() < 3) {
+      throw InterpreterSemanticError("Expected conditional");
+    }
+    if ((node->op == Opcode::And || node->op == Opcode::Or) && node->children.size() < 2) {
+      throw InterpreterSemanticError("Expected bool");
+    }
+    m_frames.push_back(Frame{node, 0, m_values.size()});
+  }
+
+  // Finish frames until one needs another argument evaluated
+  node = nullptr;
+  while (!node && !m_frames.empty()) {
+    Frame & frame = m_frames.back();
+    Node* current = frame.node;
+    std::size_t argc = current->children.size();
+
+    // if is a special form: the condition selects the one branch
+    // evaluated, which then takes the place of the if
+    if (current->op == Opcode::If) {
+      if (frame.next == 0) {
+        node = current->children[frame.next++];
+        continue;
+      }
+      bool test = m_values.back().getBool();
+      m_values.pop_back();
+      m_frames.pop_back();
+      node = current->children[test ? 1 : 2];
+      continue;
+    }
 
-  // Otherwise, it’s a valid user-defined symbol
-  return true;
-}
+    // and / or are special forms: clauses are evaluated left to right
+    // until one decides the result, which is then that clause's value
+    if (current->op == Opcode::And || current->op == Opcode::Or) {
+      if (frame.next > 0) {
+        bool clause = boolArg(m_values.back());
+        m_values.pop_back();
+        if (clause == (current->op == Opcode::Or) || frame.next == argc) {
+          m_frames.pop_back();
+          m_values.push_back(Expression(clause));
+          continue;
+        }
+      }
+      node = current->children[frame.next++];
+      continue;
+    }
 
-bool Interpreter::parse(std::istream & input) noexcept {
-  try {
-    std::stringstream buffer;
-    buffer << input.rdbuf();
-    std::string input_str = buffer.str();
-    auto tokens = tokenize(input_str);
-
-    // Require at least one opening paren
-    if (tokens.empty() || tokens.front() != "(") {
-      return false;
+    // Leaf arguments are pushed in place; the first list argument gets
+    // its own frame
+    while (frame.next < argc && current->children[frame.next]->children.empty()) {
+      m_values.push_back(leafValue(current->children[frame.next++]));
+    }
+    if (frame.next < argc) {
+      node = current->children[frame.next++];
+      continue;
     }
 
-    m_og_size = tokens.size();
-    m_ast = buildAST(tokens);
-    auto & args = m_ast.getArgs();
-    std::vector<Expression> filtered;
-    std::string bracket = "(";
-    std::string end_bracket = ")";
-    int bracket_count = 0;
-    int define_count = 0;
-    int begin_count = 0;
-    int sym_count = 0;
-    int bool_count = 0;
-    //Check for valid syntax
-    filtered.push_back(Expression(bracket));
-    for (size_t i = 0; i < args.size(); i++)
-    {
-      filtered.push_back(args[i]);
-      if ( !(args[i].isSymbol() && (args[i].getSymbol() == ")" || args[i].getSymbol() == "(" ) ))
-      {
-        if ( args[i].isSymbol() && args[i].getSymbol() == "begin")
-        {
-          begin_count++;
-        }
+    // The arguments are applied where they lie on the value stack
+    ArgList<Expression> args{m_values.data() + frame.base, m_values.size() - frame.base};
+    Expression result = applyOp(current->op, current->data.asSymbol(), args);
+    m_values.resize(frame.base);
+    m_frames.pop_back();
+    m_values.push_back(result);
+  }
 
-        if ( args[i].isSymbol() && args[i].getSymbol() == "define")
-        {
-          define_count++;
-        }
+  if (!node) {
+    return m_values.back();
+  }
+}
+}
 
-        if ( args[i].isSymbol() && !(args[i].getSymbol() == "begin" ) )
-        {
-          sym_count++;
-          
-        }
+// Same post-order evaluation as evalExpr over the flat layout, carrying
+// NaN-boxed Values instead of Expressions
+Value Interpreter::evalFlat(std::uint32_t index) {
+m_flatFrames.clear();
+m_flatValues.clear();
+
+bool start = true;
+for (;;) {
+  if (start) {
+    std::uint32_t count = m_flat.childCount[index];
+    if (count == 0) {
+      m_flatValues.push_back(m_flat.values[index]);
+    } else {
+      if (!m_flat.values[index].isSymbol()) {
+        throw InterpreterSemanticError("Not a symbol");
+      }
+      Opcode op = m_flat.opcodes[index];
+      if (op == Opcode::If && count < 3) {
+        throw InterpreterSemanticError("Expected conditional");
+      }
+      if ((op == Opcode::And || op == Opcode::Or) && count < 2) {
+        throw InterpreterSemanticError("Expected bool");
+      }
+      m_flatFrames.push_back(FlatFrame{index, 0, m_flatValues.size()});
+    }
+  }
 
-        if (args[i].isBool())
-        {
-          bool_count++;
-          
-        }
-        
+  start = false;
+  while (!start && !m_flatFrames.empty()) {
+    FlatFrame & frame = m_flatFrames.back();
+    std::uint32_t current = frame.index;
+    Opcode op = m_flat.opcodes[current];
+    std::uint32_t first = m_flat.firstChild[current];
+    std::uint32_t count = m_flat.childCount[current];
 
+    if (op == Opcode::If) {
+      if (frame.next == 0) {
+        index = first + frame.next++;
+        start = true;
+        continue;
       }
-      else{
-        bracket_count++;
+      Value test = m_flatValues.back();
+      if (!test.isBool()) {
+        throw InterpreterSemanticError("Not a boolean");
       }
-      
+      m_flatValues.pop_back();
+      m_flatFrames.pop_back();
+      index = first + (test.asBool() ? 1 : 2);
+      start = true;
+      continue;
     }
 
-     //Check for extra bracket
-     if (bracket_count % 2 != 0)
-     {
-       throw InterpreterSemanticError("extra input error ");
-     }
-     
-     if (begin_count > 2)
-     {
-       throw InterpreterSemanticError("extra input error ");
-     }
- 
-    //  if ( (begin_count == 0 && define_count == 0 && sym_count > 1 && bool_count == 0) || (begin_count == 0 && define_count == 0 && sym_count > 1 && bool_count == 0 && bracket_count % 2 != 0)) 
-    //  {
-    //    throw InterpreterSemanticError("extra input error ");
-    //  }
-
-    filtered.push_back(Expression(end_bracket));
-    args = filtered;
-    std::size_t pos = 0;
-    ASTroot = ASTtree(args, pos);
-    
-    
-    
-    
-    // Check for extra input
-    if (!tokens.empty()) {
-      return false;
+    if (op == Opcode::And || op == Opcode::Or) {
+      if (frame.next > 0) {
+        bool clause = boolValue(m_flatValues.back());
+        m_flatValues.pop_back();
+        if (clause == (op == Opcode::Or) || frame.next == count) {
+          m_flatFrames.pop_back();
+          m_flatValues.push_back(Value::boolean(clause));
+          continue;
+        }
+      }
+      index = first + frame.next++;
+      start = true;
+      continue;
     }
 
-    if (pos != args.size())
-    {
-      throw InterpreterSemanticError("extra input error ");
+    while (frame.next < count && m_flat.childCount[first + frame.next] == 0) {
+      m_flatValues.push_back(m_flat.values[first + frame.next++]);
+    }
+    if (frame.next < count) {
+      index = first + frame.next++;
+      start = true;
+      continue;
     }
-    
 
-    return true;
-  } catch (...) {
-    return false;
+    ArgList<Value> args{m_flatValues.data() + frame.base, m_flatValues.size() - frame.base};
+    Value result = applyValueOp(op, m_flat.values[current].asSymbol(), args);
+    m_flatValues.resize(frame.base);
+    m_flatFrames.pop_back();
+    m_flatValues.push_back(result);
   }
-}
-
 
-Expression Interpreter::eval() {
-  try {
-    return evalExpr(ASTroot);
-  } catch (const InterpreterSemanticError & err) {
-    std::cerr << "Evaluation error: " << err.what() << std::endl;
-    throw InterpreterSemanticError("Evaluation error ");
+  if (!start) {
+    return m_flatValues.back();
   }
 }
+}
 
 
-Expression Interpreter::evalExpr(Node* ASTrootnode) {
-if (ASTrootnode->children.empty()) { //Empty node then return the data
-    return ASTrootnode->data;
-}
-  
-std::string op = ASTrootnode->data.getSymbol(); 
+// Breadth-first copy of the Node tree into m_flat, so siblings end up in
+// consecutive slots
+void Interpreter::buildFlat() {
+  m_flat.clear();
+  if (!ASTroot) {
+    return;
+  }
 
-std::vector<Expression> argValues;
+  std::vector<const Node*> order;
+  order.push_back(ASTroot);
+  m_flat.addNode(ASTroot->data, ASTroot->op);
 
-// Recursive Thing
-for (Node* child : ASTrootnode->children) {
-  argValues.push_back(evalExpr(child));
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    const Node* node = order[i];
+    std::uint32_t first = static_cast<std::uint32_t>(m_flat.size());
+    for (const Node* child : node->children) {
+      m_flat.addNode(child->data, child->op);
+      order.push_back(child);
+    }
+    m_flat.setChildren(static_cast<std::uint32_t>(i), first,
+                       static_cast<std::uint32_t>(node->children.size()));
+  }
 }
 
-// Perform operation
-if (op == "+") {
-  double sum = 0;
-  if (argValues.size() < 2)
-  {
-    throw InterpreterSemanticError("Expected number");
+
+// Numeric value of an argument: a number, or a symbol bound to a number
+double Interpreter::numberArg(const Expression & arg) const {
+  if (arg.isNumber()) {
+    return arg.getNumber();
   }
-  
-  for (const auto& arg : argValues) {
-    double number_to_add = 0;
-    Expression expr;
-      if (!arg.isNumber()){
-        try
-        {
-          expr = env.get(arg.getSymbol());
-          number_to_add = expr.m_numberValue;
-        }
-        catch(...)
-        {
-          throw InterpreterSemanticError("Expected number");
-        }
-        
-      }
-      else{
-        number_to_add = arg.getNumber();
-      }
-      sum += number_to_add;
+  if (arg.isSymbol()) {
+    const Expression* bound = env.lookup(arg.getSymbolId());
+    if (bound && bound->isNumber()) {
+      return bound->getNumber();
+    }
   }
-  return Expression(sum);
+  throw InterpreterSemanticError("Expected number");
 }
 
-if (op == "if")
-{
-  if (argValues.size() < 3)
-  {
-    throw InterpreterSemanticError("Expected conditional");
+// Boolean value of an argument: a boolean, or a symbol bound to a boolean
+bool Interpreter::boolArg(const Expression & arg) const {
+  if (arg.isBool()) {
+    return arg.getBool();
   }
-
-  if (argValues[0].getBool() == true)
-  {
-    return Expression(argValues[1]);
-  }else{return Expression(argValues[2]);}
-  
-  
+  if (arg.isSymbol()) {
+    const Expression* bound = env.lookup(arg.getSymbolId());
+    if (bound && bound->isBool()) {
+      return bound->getBool();
+    }
+  }
+  throw InterpreterSemanticError("Expected bool");
 }
 
-if (op == "define")
-{
-  if (argValues.size() < 2 || !(argValues[0].isSymbol()))
-  {
-    throw InterpreterSemanticError("Expected conditional");
+
+// Numeric value of a NaN-boxed argument: a number, or a symbol bound to
+// a number
+double Interpreter::numberValue(Value arg) const {
+  if (arg.isNumber()) {
+    return arg.asNumber();
   }
-  std::string variable_name;
-  if (argValues[1].isBool())
-  {
-    argValues[0].m_type = ExpressionType::Boolean;
-    argValues[0].m_boolValue = argValues[1].getBool();
-    variable_name = argValues[0].m_symbolValue;
+  if (arg.isSymbol()) {
+    const Expression* bound = env.lookup(arg.asSymbol());
+    if (bound && bound->isNumber()) {
+      return bound->getNumber();
+    }
   }
-  else if(argValues[1].isNumber()){
-    argValues[0].m_type = ExpressionType::Number;
-    argValues[0].m_numberValue = argValues[1].getNumber();
-    variable_name = argValues[0].m_symbolValue;
+  throw InterpreterSemanticError("Expected number");
+}
+
+// Boolean value of a NaN-boxed argument: a boolean, or a symbol bound to
+// a boolean
+bool Interpreter::boolValue(Value arg) const {
+  if (arg.isBool()) {
+    return arg.asBool();
   }
-  else if(argValues[1].isSymbol()){
-    bool found = true;
-    Expression expr;
-     try
-    {
-     expr = env.get(argValues[1].m_symbolValue);
-    }
-  catch(...)
-    {
-      found = false;
-      std::cout << "not found";
-    }
-    if(found){
-      argValues[0].m_numberValue = expr.m_numberValue;
-      argValues[0].m_boolValue = expr.m_boolValue;
-      variable_name = argValues[0].m_symbolValue;
-      
+  if (arg.isSymbol()) {
+    const Expression* bound = env.lookup(arg.asSymbol());
+    if (bound && bound->isBool()) {
+      return bound->getBool();
     }
   }
-  static const std::unordered_set<std::string> validOperators = {
-    "not",
-    "and",
-    "or",
-    "<",
-    "<=",
-    ">",
-    ">=",
-    "=",
-    "+",
-    "-",
-    "*",
-    "/",
-    "define",
-    "begin",
-    "if"
-  };
+  throw InterpreterSemanticError("Expected bool");
+}
 
-   // Check if it's a reserved word
-  if (validOperators.count(variable_name)){
-    throw InterpreterSemanticError("Cant define such names");
-  }
 
-  bool valid = false;
-  try
-  {
-    Expression expr = env.get(variable_name);
-  }
-  catch(...)
+// applyOp over NaN-boxed Values. Arithmetic, comparison and logic work on
+// the raw values; the special forms go through applyOp.
+Value Interpreter::applyValueOp(Opcode op, SymbolId head, ArgList<Value> argValues) {
+switch (op) {
+case Opcode::Add:
+case Opcode::Multiply: {
+  if (argValues.size() < 2)
   {
-    valid = true;
+    throw InterpreterSemanticError("Expected number");
   }
 
- 
-  
-  
-  if (!valid)
-  {
-    throw InterpreterSemanticError("Cant define such names");
+  bool add = op == Opcode::Add;
+  double result = add ? 0 : 1;
+  for (Value arg : argValues) {
+    result = add ? result + numberValue(arg) : result * numberValue(arg);
   }
-  
-  
-  
-  env.define(variable_name, argValues[0]);
-  return argValues[0];
+  return Value::number(result);
 }
 
-if (op == "begin")
-{
-  if (argValues.size() < 1)
+case Opcode::Subtract: {
+  if (argValues.size() > 2)
   {
-    //throw InterpreterSemanticError("Expected begin sequence");
+    throw InterpreterSemanticError("Expected number");
   }
 
-  if (argValues[argValues.size() - 1].isSymbol())
+  if (argValues.size() == 1)
   {
-    auto expr = env.get(argValues[argValues.size() - 1].getSymbol());
-    return Expression(expr);
+    return Value::number(-numberValue(argValues[0]));
   }
-  else{
-    return Expression(argValues[argValues.size() - 1]);
-  }
-  
+  return Value::number(numberValue(argValues[0]) - numberValue(argValues[1]));
 }
 
-if (op == "-") {
-  if (argValues.size() > 2)
+case Opcode::Divide:
+case Opcode::Less:
+case Opcode::LessEqual:
+case Opcode::Greater:
+case Opcode::GreaterEqual:
+case Opcode::Equal: {
+  if (argValues.size() != 2)
   {
     throw InterpreterSemanticError("Expected number");
   }
 
-  if (argValues.size() == 1)
-  {
-    Expression expr;
-    if (!argValues[0].isNumber())
-    {
-      try
-        {
-          expr = env.get(argValues[0].getSymbol());
-          double neg = -(expr.m_numberValue);
-          return Expression(neg);
-        }
-        catch(...)
-        {
-          throw InterpreterSemanticError("Expected number");
-        }
-    }else if (argValues[0].isNumber())
-    {
-      double neg = argValues[0].getNumber();
-      return Expression(-neg);
-    }
-    
-    
-  }else if (argValues.size() == 2)
-  {
-    Expression expr1;
-    Expression expr2;
-    if (!argValues[0].isNumber())
-    {
-      try
-        {
-          expr1 = env.get(argValues[0].getSymbol());
-        }
-        catch(...)
-        {
-          throw InterpreterSemanticError("Expected number");
-        }
-    }
-    else if (argValues[0].isNumber())
-    {
-      expr1 = argValues[0];
-    }
-    
-    if (!argValues[1].isNumber())
-    {
-      try
-        {
-          expr2 = env.get(argValues[1].getSymbol());
-        }
-        catch(...)
-        {
-          throw InterpreterSemanticError("Expected number");
-        }
-    }
-    else if (argValues[1].isNumber())
-    {
-      expr2 = argValues[1];
-    }
-    
+  double left = numberValue(argValues[0]);
+  double right = numberValue(argValues[1]);
 
-    double result = expr1.m_numberValue - expr2.m_numberValue;
-    return Expression(result);
+  switch (op) {
+    case Opcode::Divide: return Value::number(left / right);
+    case Opcode::Less: return Value::boolean(left < right);
+    case Opcode::LessEqual: return Value::boolean(left <= right);
+    case Opcode::Greater: return Value::boolean(left > right);
+    case Opcode::GreaterEqual: return Value::boolean(left >= right);
+    default: return Value::boolean(left == right);
+  }
+}
 
-    
+case Opcode::Not: {
+  if (argValues.size() != 1)
+  {
+    throw InterpreterSemanticError("Expected bool");
   }
+  return Value::boolean(!boolValue(argValues[0]));
+}
 
+default: {
+  std::vector<Expression> expressions;
+  expressions.reserve(argValues.size());
+  for (Value arg : argValues) {
+    expressions.push_back(toExpression(arg));
+  }
+  return toValue(applyOp(op, head, ArgList<Expression>{expressions.data(), expressions.size()}));
+}
+}
 }
 
 
-if (op == "/") {
-    if (argValues.size() != 2)
-    {
-      throw InterpreterSemanticError("Expected number");
-    }
-  
-      Expression expr1;
-      Expression expr2;
-      if (!argValues[0].isNumber())
-      {
-        try
-          {
-            expr1 = env.get(argValues[0].getSymbol());
-          }
-          catch(...)
-          {
-            throw InterpreterSemanticError("Expected number");
-          }
-      }
-      else if (argValues[0].isNumber())
-      {
-        expr1 = argValues[0];
-      }
-      
-      if (!argValues[1].isNumber())
-      {
-        try
-          {
-            expr2 = env.get(argValues[1].getSymbol());
-          }
-          catch(...)
-          {
-            throw InterpreterSemanticError("Expected number");
-          }
-      }
-      else if (argValues[1].isNumber())
-      {
-        expr2 = argValues[1];
-      }
-      
-  
-      double result = expr1.m_numberValue / expr2.m_numberValue;
-      return Expression(result);
-  
-      
-}
-  
-if (op == "*") {
-  double mult = 1;
+// Apply operator op, whose list head is the symbol head, to already
+// evaluated arguments
+Expression Interpreter::applyOp(Opcode op, SymbolId head, ArgList<Expression> argValues) {
+switch (op) {
+case Opcode::Add: {
   if (argValues.size() < 2)
   {
     throw InterpreterSemanticError("Expected number");
   }
-  
+
+  double sum = 0;
   for (const auto& arg : argValues) {
-    double number_to_mult = 0;
-    Expression expr;
-      if (!arg.isNumber()){
-        try
-        {
-          expr = env.get(arg.getSymbol());
-          number_to_mult = expr.m_numberValue;
-        }
-        catch(...)
-        {
-          throw InterpreterSemanticError("Expected number");
-        }
-        
-      }
-      else{
-        number_to_mult = arg.getNumber();
-      }
-      mult = mult * number_to_mult;
+    sum += numberArg(arg);
   }
-  return Expression(mult);
+  return Expression(sum);
 }
 
-if (op == "<") {
-  if (argValues.size() != 2)
+case Opcode::Define: {
+  if (argValues.size() < 2 || !(argValues[0].isSymbol()))
   {
-    throw InterpreterSemanticError("Expected number");
+    throw InterpreterSemanticError("Expected conditional");
   }
-
-    Expression expr1;
-    Expression expr2;
-    if (!argValues[0].isNumber())
-    {
-      try
-        {
-          expr1 = env.get(argValues[0].getSymbol());
-        }
-        catch(...)
-        {
-          throw InterpreterSemanticError("Expected number");
-        }
-    }
-    else if (argValues[0].isNumber())
-    {
-      expr1 = argValues[0];
-    }
-    
-    if (!argValues[1].isNumber())
-    {
-      try
-        {
-          expr2 = env.get(argValues[1].getSymbol());
-        }
-        catch(...)
-        {
-          throw InterpreterSemanticError("Expected number");
-        }
-    }
-    else if (argValues[1].isNumber())
-    {
-      expr2 = argValues[1];
+  static const SymbolId unnamed = intern("");
+  SymbolId variable = unnamed;
+  Expression value = argValues[0];
+  if (argValues[1].isBool() || argValues[1].isNumber())
+  {
+    value = argValues[1];
+    variable = argValues[0].getSymbolId();
+  }
+  else if(argValues[1].isSymbol()){
+    // Bind a copy of the other symbol's current value
+    const Expression* bound = env.lookup(argValues[1].getSymbolId());
+    if (bound) {
+      value = *bound;
+      variable = argValues[0].getSymbolId();
+    } else {
+      std::cout << "not found";
     }
-    
-
-    bool result = (expr1.m_numberValue < expr2.m_numberValue);
-    return Expression(result);
+  }
 
-    
-}
+   // Check if it's a reserved word
+  if (SymbolTable::isReserved(variable)){
+    throw InterpreterSemanticError("Cant define such names");
+  }
 
-if (op == "<=") {
-  if (argValues.size() != 2)
+  if (env.lookup(variable))
   {
-    throw InterpreterSemanticError("Expected number");
+    throw InterpreterSemanticError("Cant define such names");
   }
 
-    Expression expr1;
-    Expression expr2;
-    if (!argValues[0].isNumber())
-    {
-      try
-        {
-          expr1 = env.get(argValues[0].getSymbol());
-        }
-        catch(...)
-        {
-          throw InterpreterSemanticError("Expected number");
-        }
-    }
-    else if (argValues[0].isNumber())
-    {
-      expr1 = argValues[0];
-    }
-    
-    if (!argValues[1].isNumber())
-    {
-      try
-        {
-          expr2 = env.get(argValues[1].getSymbol());
-        }
-        catch(...)
-        {
-          throw InterpreterSemanticError("Expected number");
-        }
-    }
-    else if (argValues[1].isNumber())
-    {
-      expr2 = argValues[1];
-    }
-    
-
-    bool result = (expr1.m_numberValue <= expr2.m_numberValue);
-    return Expression(result);
-
-    
+  env.define(variable, value);
+  return value;
 }
 
-if (op == ">") {
-  if (argValues.size() != 2)
+case Opcode::Begin: {
+  if (argValues[argValues.size() - 1].isSymbol())
   {
-    throw InterpreterSemanticError("Expected number");
-  }
-
-    Expression expr1;
-    Expression expr2;
-    if (!argValues[0].isNumber())
-    {
-      try
-        {
-          expr1 = env.get(argValues[0].getSymbol());
-        }
-        catch(...)
-        {
-          throw InterpreterSemanticError("Expected number");
-        }
-    }
-    else if (argValues[0].isNumber())
-    {
-      expr1 = argValues[0];
+    SymbolId last = argValues[argValues.size() - 1].getSymbolId();
+    const Expression* bound = env.lookup(last);
+    if (!bound) {
+      throw InterpreterSemanticError("Undefined symbol: " + symbolName(last));
     }
-    
-    if (!argValues[1].isNumber())
-    {
-      try
-        {
-          expr2 = env.get(argValues[1].getSymbol());
-        }
-        catch(...)
-        {
-          throw InterpreterSemanticError("Expected number");
-        }
-    }
-    else if (argValues[1].isNumber())
-    {
-      expr2 = argValues[1];
-    }
-    
-
-    bool result = (expr1.m_numberValue > expr2.m_numberValue);
-    return Expression(result);
-
-    
+    return *bound;
+  }
+  else{
+    return Expression(argValues[argValues.size() - 1]);
+  }
 }
 
-if (op == ">=") {
-  if (argValues.size() != 2)
+case Opcode::Subtract: {
+  if (argValues.size() > 2)
   {
     throw InterpreterSemanticError("Expected number");
   }
 
-    Expression expr1;
-    Expression expr2;
-    if (!argValues[0].isNumber())
-    {
-      try
-        {
-          expr1 = env.get(argValues[0].getSymbol());
-        }
-        catch(...)
-        {
-          throw InterpreterSemanticError("Expected number");
-        }
-    }
-    else if (argValues[0].isNumber())
-    {
-      expr1 = argValues[0];
-    }
-    
-    if (!argValues[1].isNumber())
-    {
-      try
-        {
-          expr2 = env.get(argValues[1].getSymbol());
-        }
-        catch(...)
-        {
-          throw InterpreterSemanticError("Expected number");
-        }
-    }
-    else if (argValues[1].isNumber())
-    {
-      expr2 = argValues[1];
-    }
-    
-
-    bool result = (expr1.m_numberValue >= expr2.m_numberValue);
-    return Expression(result);
+  if (argValues.size() == 1)
+  {
+    return Expression(-numberArg(argValues[0]));
+  }
 
-    
+  return Expression(numberArg(argValues[0]) - numberArg(argValues[1]));
 }
 
-if (op == "=") {
+case Opcode::Divide: {
   if (argValues.size() != 2)
   {
     throw InterpreterSemanticError("Expected number");
   }
 
-    Expression expr1;
-    Expression expr2;
-    if (!argValues[0].isNumber())
-    {
-      try
-        {
-          expr1 = env.get(argValues[0].getSymbol());
-        }
-        catch(...)
-        {
-          throw InterpreterSemanticError("Expected number");
-        }
-    }
-    else if (argValues[0].isNumber())
-    {
-      expr1 = argValues[0];
-    }
-    
-    if (!argValues[1].isNumber())
-    {
-      try
-        {
-          expr2 = env.get(argValues[1].getSymbol());
-        }
-        catch(...)
-        {
-          throw InterpreterSemanticError("Expected number");
-        }
-    }
-    else if (argValues[1].isNumber())
-    {
-      expr2 = argValues[1];
-    }
-    
-
-    bool result = (expr1.m_numberValue == expr2.m_numberValue);
-    return Expression(result);
-
-    
+  return Expression(numberArg(argValues[0]) / numberArg(argValues[1]));
 }
 
-if (op == "and") {
+case Opcode::Multiply: {
   if (argValues.size() < 2)
   {
-    throw InterpreterSemanticError("Expected bool");
+    throw InterpreterSemanticError("Expected number");
   }
 
-  bool result = argValues[0].m_boolValue;
-  
+  double mult = 1;
   for (const auto& arg : argValues) {
-    bool number;
-    Expression expr;
-      if (!arg.isBool()){
-        try
-        {
-          expr = env.get(arg.getSymbol());
-          number = expr.m_boolValue;
-          //std::cout << number;
-        }
-        catch(...)
-        {
-          throw InterpreterSemanticError("Expected bool");
-        }
-        
-      }
-      else{
-        number = arg.getBool();
-      }
-      result = (result && number);
+    mult = mult * numberArg(arg);
   }
-  return Expression(result);
+  return Expression(mult);
 }
 
-if (op == "or") {
-  if (argValues.size() < 2)
+case Opcode::Less:
+case Opcode::LessEqual:
+case Opcode::Greater:
+case Opcode::GreaterEqual:
+case Opcode::Equal: {
+  if (argValues.size() != 2)
   {
-    throw InterpreterSemanticError("Expected bool");
+    throw InterpreterSemanticError("Expected number");
   }
 
-  bool result = argValues[0].m_boolValue;
-  
-  for (const auto& arg : argValues) {
-    bool number;
-    Expression expr;
-      if (!arg.isBool()){
-        try
-        {
-          expr = env.get(arg.getSymbol());
-          number = expr.m_boolValue;
-        }
-        catch(...)
-        {
-          throw InterpreterSemanticError("Expected bool");
-        }
-        
-      }
-      else{
-        number = arg.getBool();
-      }
-      result = (result || number);
+  double left = numberArg(argValues[0]);
+  double right = numberArg(argValues[1]);
+
+  switch (op) {
+    case Opcode::Less: return Expression(left < right);
+    case Opcode::LessEqual: return Expression(left <= right);
+    case Opcode::Greater: return Expression(left > right);
+    case Opcode::GreaterEqual: return Expression(left >= right);
+    default: return Expression(left == right);
   }
-  return Expression(result);
 }
 
-if (op == "not") {
+case Opcode::Not: {
   if (argValues.size() != 1)
   {
     throw InterpreterSemanticError("Expected bool");
   }
 
-    Expression expr;
-    if (!argValues[0].isBool())
-    {
-      try
-        {
-          expr = env.get(argValues[0].getSymbol());
-          bool neg = !(expr.m_boolValue);
-          return Expression(neg);
-        }
-        catch(...)
-        {
-          throw InterpreterSemanticError("Expected bool");
-        }
-    }else if (argValues[0].isBool())
-    {
-      bool neg = !(argValues[0].getBool());
-      return Expression(neg);
-    }
-  }
-  throw InterpreterSemanticError("Unknown operator: " + op);
+  return Expression(!boolArg(argValues[0]));
 }
 
-
-
-
-
-
+case Opcode::If:     // special forms, evaluated before their arguments
+case Opcode::And:
+case Opcode::Or:
+case Opcode::Unknown:
+  break;
+}
+  throw InterpreterSemanticError("Unknown operator: " + symbolName(head));
+}
@@ -3,109 +3,203 @@
 #define INTERPRETER_HPP
 
 // system includes
+#include <atomic>
 #include <string>
 #include <istream>
 #include <stack>
 #include <sstream>
+#include <thread>
 #include <vector>
 
 // module includes
+#include "arena.hpp"
+#include "bytecode.hpp"
 #include "expression.hpp"
+#include "flat_ast.hpp"
+#include "jit.hpp"
+#include "opcode.hpp"
+#include "program.hpp"
+#include "value.hpp"
 #include "environment.hpp"
+#include "shared_environment.hpp"
+#include "symbol_table.hpp"
 #include "interpreter_semantic_error.hpp"
 
 class Interpreter {
 public:
 
   Interpreter() : ASTroot(nullptr) {}
-
-  ~Interpreter() {
-    deleteTree(ASTroot);
-  }
+  ~Interpreter();
 
   Interpreter(const Interpreter&) = delete;
   Interpreter& operator=(const Interpreter&) = delete;
 
+  // Parse expression and load it; false, with no program loaded, when it
+  // is not a valid program
   bool parse(std::istream & expression) noexcept;
 
-  Expression eval();
+  // Evaluate program, which may be shared with other interpreters on other
+  // threads, from now on; nullptr unloads the current program
+  void load(std::shared_ptr<const Program> program);
 
-  struct Node {
-    Expression data;
-    std::vector<Node*> children;
+  // The loaded program, to load into other interpreters
+  std::shared_ptr<const Program> program() const noexcept { return m_program; }
 
-    Node(const Expression& expr) : data(expr) {}
+  Expression eval();
 
-    // No need to delete children here; Interpreter owns the tree
-    ~Node() = default;
+  // Fold constant subtrees, pi included, into literals and drop identity
+  // operands such as the 1 in (* x 1) and the 0 in (+ x 0) wherever every
+  // result and error stays the same. Call between parse() and eval();
+  // the loaded program is replaced by a simplified copy, so interpreters
+  // sharing it are unaffected. Returns the number of nodes removed.
+  std::size_t optimize();
+
+  // Freeze the environment as it is now. The snapshot is immutable and
+  // can be forked any number of times, by this or other interpreters.
+  EnvironmentSnapshot snapshot() { return env.snapshot(); }
+
+  // Continue in a fresh copy-on-write fork of snapshot: the parsed program
+  // and later ones see its bindings, and their defines go to the fork only.
+  // Ends any sharing started by share().
+  void fork(EnvironmentSnapshot snapshot);
+
+  // Continue with the bindings of shared beneath a private layer for this
+  // interpreter's own defines. eval() moves the private layer onto each
+  // new version shared publishes, at its start; evaluation itself reads
+  // the version it holds without synchronization.
+  void share(std::shared_ptr<const SharedEnvironment> shared);
+
+  // Evaluation engine used by eval()
+  enum class Backend {
+    TreeWalker, // recursive walk over the Node tree
+    FlatAST,    // walk over a struct-of-arrays copy of the tree using
+                // NaN-boxed Values
+    Bytecode,   // compile the tree once to stack VM code and run that
+    Jit,        // x86-64 machine code for arithmetic and comparison trees;
+                // other programs run on the tree walker
+    Tiered      // tree walker at first; a program evaluated tierThreshold
+                // times is compiled to bytecode in the background and runs
+                // as bytecode once that is ready
   };
 
-  Node* ASTtree(std::vector<Expression>& tokens, std::size_t& pos) {
-    if (pos >= tokens.size()) {
-      throw InterpreterSemanticError("Unexpected end of input");
-    }
-
-    if (tokens[pos].isSymbol() && tokens[pos].getSymbol() == "(") {
-      ++pos; // consume '('
-      if (pos >= tokens.size()) {
-        throw InterpreterSemanticError("Expected expression after '('");
-      }
-
-      Expression head = tokens[pos++];
-      Node* node = new Node{head};
-
-      bool isFirst = true;
-
-      while (pos < tokens.size() && !(tokens[pos].isSymbol() && tokens[pos].getSymbol() == ")")) {
-        if (tokens[pos].isSymbol() && tokens[pos].getSymbol() == "(") {
-          if (!isFirst) {
-            delete node;
-            throw InterpreterSemanticError("Only first child can have kids");
-          }
-          node->children.push_back(ASTtree(tokens, pos));
-        } else {
-          node->children.push_back(new Node{tokens[pos++]});
-        }
-
-        isFirst = false;
-        if (node->data == head) {
-          isFirst = true;
-        }
-      }
-
-      if (pos >= tokens.size() || tokens[pos].getSymbol() != ")") {
-        deleteTree(node);
-        throw InterpreterSemanticError("Missing closing ')'");
-      }
-
-      ++pos; // consume ')'
-      return node;
-    } else {
-      return new Node{tokens[pos++]};
-    }
-  }
+  void setBackend(Backend backend) noexcept { m_backend = backend; }
+  Backend backend() const noexcept { return m_backend; }
+
+  // The bytecode and JIT compilers recurse over the tree, so programs
+  // nested deeper than this are evaluated by the tree walker instead.
+  // Compiling at this depth takes about 2 MB of stack in an unoptimized
+  // build, a quarter of the usual 8 MB.
+  static const std::size_t MaxCompileDepth = 2000;
+
+  // Evaluations after which the Tiered backend compiles a program
+  void setTierThreshold(std::size_t evals) noexcept { m_tierThreshold = evals; }
+
+  // Number of eval() calls on the current program
+  std::size_t evalCount() const noexcept { return m_evalCount; }
+
+  // True once the Tiered backend has bytecode for the current program
+  bool promoted() const noexcept { return m_promoted.load(std::memory_order_acquire) != nullptr; }
+
+  // Correctness mode for the Jit backend: every native evaluation is
+  // repeated by the tree walker, and a differing result is an error
+  void setJitVerify(bool verify) noexcept { m_jitVerify = verify; }
+
+  // True when the parsed program has been compiled to native code
+  bool jitCompiled() const noexcept { return !m_jit.empty(); }
+
+  // Write the parsed program as a standalone C++ translation unit that
+  // computes what eval() would on a fresh interpreter
+  void transpile(std::ostream & out) const;
+
+  // Parsed program types, see program.hpp
+  typedef Program::Node Node;
+  typedef Program::NodeList NodeList;
 
 private:
   // Members
-  Expression m_ast;
+  std::shared_ptr<const Program> m_program;
+  Node* ASTroot; // root of m_program
+  std::vector<std::uint32_t> m_slotMap; // program slot -> environment slot
   Environment env;
-  Node* ASTroot;
-  std::size_t m_og_size = 0;
+  Backend m_backend = Backend::TreeWalker;
+  FlatAST m_flat;
+  BytecodeProgram m_bytecode;
+  std::vector<Value> m_vmStack;
+  JitProgram m_jit;
+  std::vector<double> m_jitArgs;
+  bool m_jitTried = false;
+  bool m_jitVerify = false;
+
+  // Tiering state for the current program. m_compiler builds the bytecode
+  // from the immutable Node tree and publishes it through m_promoted.
+  std::size_t m_evalCount = 0;
+  std::size_t m_tierThreshold = 1000;
+  bool m_tierStarted = false;
+  std::thread m_compiler;
+  std::atomic<BytecodeProgram*> m_promoted{nullptr};
+
+  // Shared environment beneath env, with the version env is based on
+  std::shared_ptr<const SharedEnvironment> m_shared;
+  EnvironmentSnapshot m_sharedBase;
+  std::uint64_t m_sharedVersion = 0;
+
+  // Work stacks of the iterative evaluators, kept to reuse their storage.
+  // Each frame is an operator with the index of its next argument and the
+  // position of its first argument's value.
+  struct Frame {
+    Node* node;
+    std::size_t next;
+    std::size_t base;
+  };
+  std::vector<Frame> m_frames;
+  std::vector<Expression> m_values;
+
+  struct FlatFrame {
+    std::uint32_t index;
+    std::uint32_t next;
+    std::size_t base;
+  };
+  std::vector<FlatFrame> m_flatFrames;
+  std::vector<Value> m_flatValues;
+
+  // Arguments of one operator application: a view of consecutive values,
+  // usually on an evaluator's value stack, so applying an operator copies
+  // and allocates nothing
+  template <typename T>
+  struct ArgList {
+    const T* items;
+    std::size_t count;
+
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+    std::size_t size() const { return count; }
+    const T & operator[](std::size_t i) const { return items[i]; }
+  };
 
   // Helpers
-  std::vector<std::string> tokenize(const std::string & str) const;
-  Expression buildAST(std::vector<std::string> & tokens);
+  void resolveSlots();
+  void dropCompiled() noexcept;
+  Expression leafValue(const Node* leaf) const;
+  Node* simplifyNode(Node* node, Opcode parent, bool tailLeaves, std::size_t & removed);
   Expression evalExpr(Node* ASTrootnode);
-  bool isValidSymbol(const std::string & token);
-
-  // Recursive helper to delete AST tree
-  void deleteTree(Node* node) {
-    if (!node) return;
-    for (Node* child : node->children) {
-      deleteTree(child);
-    }
-    delete node;
-  }
+  Value evalFlat(std::uint32_t index);
+  void buildFlat();
+  void compileBytecode(BytecodeProgram & program, const Node* root) const;
+  void compileNode(BytecodeProgram & program, const Node* node, std::size_t depth) const;
+  Value runBytecode(const BytecodeProgram & program);
+  void tierUp();
+  void stopTiering() noexcept;
+  bool jitNumeric(const Node* node) const;
+  bool compileJit();
+  void jitNode(const Node* node);
+  void jitOperand(const Node* node);
+  bool runJit(Expression & result);
+  Expression applyOp(Opcode op, SymbolId head, ArgList<Expression> argValues);
+  double numberArg(const Expression & arg) const;
+  bool boolArg(const Expression & arg) const;
+  Value applyValueOp(Opcode op, SymbolId head, ArgList<Value> argValues);
+  double numberValue(Value arg) const;
+  bool boolValue(Value arg) const;
 };
 
 #endif
\ No newline at end of file
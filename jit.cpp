@@ -0,0 +1,344 @@
+// Native code module implementation: the x86-64 emitter and the lowering
+// of numeric Node trees to it
+#include "jit.hpp"
+#include "interpreter.hpp"
+#include "interpreter_semantic_error.hpp"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+#define SCALC_JIT 1
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+// ModRM base registers of the two pointer arguments (System V ABI)
+const std::uint8_t Rdi = 7;
+const std::uint8_t Rsi = 6;
+
+std::uint8_t registers(int dst, int src) {
+  return static_cast<std::uint8_t>(0xC0 | (dst << 3) | src);
+}
+
+}
+
+JitProgram::JitProgram() noexcept
+  : m_memory(nullptr), m_mapped(0), m_function(nullptr) {}
+
+JitProgram::~JitProgram() {
+  clear();
+}
+
+bool JitProgram::supported() noexcept {
+#ifdef SCALC_JIT
+  return true;
+#else
+  return false;
+#endif
+}
+
+void JitProgram::clear() noexcept {
+#ifdef SCALC_JIT
+  if (m_memory) {
+    munmap(m_memory, m_mapped);
+  }
+#endif
+  m_memory = nullptr;
+  m_mapped = 0;
+  m_function = nullptr;
+  m_code.clear();
+  m_constants.clear();
+  m_slotIndex.clear();
+  slots.clear();
+  returnsBool = false;
+}
+
+void JitProgram::bytes(std::initializer_list<std::uint8_t> values) {
+  m_code.insert(m_code.end(), values.begin(), values.end());
+}
+
+// [base + 8 * index] with a 32-bit displacement
+void JitProgram::memoryOperand(int xmm, std::uint8_t base, std::uint32_t index) {
+  std::uint32_t disp = index * 8;
+  bytes({static_cast<std::uint8_t>(0x80 | (xmm << 3) | base),
+         static_cast<std::uint8_t>(disp), static_cast<std::uint8_t>(disp >> 8),
+         static_cast<std::uint8_t>(disp >> 16), static_cast<std::uint8_t>(disp >> 24)});
+}
+
+// movsd xmm, [rdi + 8 * slot]
+void JitProgram::loadSlot(int xmm, SymbolId symbol) {
+  auto found = m_slotIndex.find(symbol);
+  std::uint32_t slot;
+  if (found != m_slotIndex.end()) {
+    slot = found->second;
+  } else {
+    slot = static_cast<std::uint32_t>(slots.size());
+    slots.push_back(symbol);
+    m_slotIndex[symbol] = slot;
+  }
+  bytes({0xF2, 0x0F, 0x10});
+  memoryOperand(xmm, Rdi, slot);
+}
+
+// movsd xmm, [rsi + 8 * constant]
+void JitProgram::loadConstant(int xmm, double value) {
+  m_constants.push_back(value);
+  bytes({0xF2, 0x0F, 0x10});
+  memoryOperand(xmm, Rsi, static_cast<std::uint32_t>(m_constants.size() - 1));
+}
+
+// xorpd xmm, xmm
+void JitProgram::zero(int xmm) {
+  bytes({0x66, 0x0F, 0x57, registers(xmm, xmm)});
+}
+
+// movapd dst, src
+void JitProgram::move(int dst, int src) {
+  bytes({0x66, 0x0F, 0x28, registers(dst, src)});
+}
+
+// xmm = -xmm by flipping the sign bit, exactly as unary minus does
+void JitProgram::flipSign(int xmm, int scratch) {
+  loadConstant(scratch, -0.0);
+  bytes({0x66, 0x0F, 0x57, registers(xmm, scratch)});
+}
+
+// addsd / mulsd / subsd / divsd dst, src
+void JitProgram::arith(Arith op, int dst, int src) {
+  bytes({0xF2, 0x0F, static_cast<std::uint8_t>(op), registers(dst, src)});
+}
+
+// cmpsd dst, src, predicate
+void JitProgram::compare(Predicate predicate, int dst, int src) {
+  bytes({0xF2, 0x0F, 0xC2, registers(dst, src), static_cast<std::uint8_t>(predicate)});
+}
+
+// sub rsp, 8; movsd [rsp], xmm
+void JitProgram::push(int xmm) {
+  bytes({0x48, 0x83, 0xEC, 0x08});
+  bytes({0xF2, 0x0F, 0x11, static_cast<std::uint8_t>(0x04 | (xmm << 3)), 0x24});
+}
+
+// movsd xmm, [rsp]; add rsp, 8
+void JitProgram::pop(int xmm) {
+  bytes({0xF2, 0x0F, 0x10, static_cast<std::uint8_t>(0x04 | (xmm << 3)), 0x24});
+  bytes({0x48, 0x83, 0xC4, 0x08});
+}
+
+void JitProgram::ret() {
+  bytes({0xC3});
+}
+
+bool JitProgram::finalize() {
+#ifdef SCALC_JIT
+  // Pages are never writable and executable at the same time
+  std::size_t size = m_code.size();
+  void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED) {
+    return false;
+  }
+  std::memcpy(memory, m_code.data(), size);
+  if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+    munmap(memory, size);
+    return false;
+  }
+  m_memory = memory;
+  m_mapped = size;
+  std::memcpy(&m_function, &m_memory, sizeof(m_function));
+  m_code.clear();
+  return true;
+#else
+  return false;
+#endif
+}
+
+double JitProgram::run(const double* slotValues) const noexcept {
+  return m_function(slotValues, m_constants.data());
+}
+
+
+// A tree the JIT can lower: a number, a symbol read as a number, or an
+// arithmetic operator with an arity the tree walker accepts over such trees
+bool Interpreter::jitNumeric(const Node* node) const {
+  if (node->children.empty()) {
+    return node->data.isNumber() || node->data.isSymbol();
+  }
+
+  std::size_t argc = node->children.size();
+  switch (node->op) {
+    case Opcode::Add:
+    case Opcode::Multiply:
+      if (argc < 2) return false;
+      break;
+    case Opcode::Subtract:
+      if (argc > 2) return false;
+      break;
+    case Opcode::Divide:
+      if (argc != 2) return false;
+      break;
+    default:
+      return false;
+  }
+
+  for (const Node* child : node->children) {
+    if (!jitNumeric(child)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Lower the program to m_jit when its root is an arithmetic tree or a
+// comparison of two; anything else is left to the tree walker
+bool Interpreter::compileJit() {
+  m_jit.clear();
+  if (!JitProgram::supported() || !ASTroot || ASTroot->children.empty()) {
+    return false;
+  }
+
+  const Node* root = ASTroot;
+  switch (root->op) {
+    case Opcode::Less:
+    case Opcode::LessEqual:
+    case Opcode::Greater:
+    case Opcode::GreaterEqual:
+    case Opcode::Equal: {
+      if (root->children.size() != 2 || !jitNumeric(root->children[0]) ||
+          !jitNumeric(root->children[1])) {
+        return false;
+      }
+      jitNode(root->children[0]);
+      jitOperand(root->children[1]);
+      if (root->op == Opcode::Greater || root->op == Opcode::GreaterEqual) {
+        // a > b is b < a, which keeps the false result for NaN operands
+        m_jit.compare(root->op == Opcode::Greater ? JitProgram::Predicate::Less
+                                                  : JitProgram::Predicate::LessEqual, 1, 0);
+        m_jit.move(0, 1);
+      } else {
+        m_jit.compare(root->op == Opcode::Less ? JitProgram::Predicate::Less
+                    : root->op == Opcode::LessEqual ? JitProgram::Predicate::LessEqual
+                    : JitProgram::Predicate::Equal, 0, 1);
+      }
+      m_jit.returnsBool = true;
+      break;
+    }
+    default:
+      if (!jitNumeric(root)) {
+        return false;
+      }
+      jitNode(root);
+      break;
+  }
+
+  m_jit.ret();
+  if (!m_jit.finalize()) {
+    m_jit.clear();
+    return false;
+  }
+  m_jitArgs.resize(m_jit.slots.size());
+  return true;
+}
+
+// Emit code leaving node's value in xmm0. Sums and products start from 0
+// and 1 and accumulate left to right, as applyOp does, so results match
+// the tree walker bit for bit.
+void Interpreter::jitNode(const Node* node) {
+  if (node->children.empty()) {
+    if (node->data.isNumber()) {
+      m_jit.loadConstant(0, node->data.asNumber());
+    } else {
+      m_jit.loadSlot(0, node->data.asSymbol());
+    }
+    return;
+  }
+
+  switch (node->op) {
+    case Opcode::Add:
+    case Opcode::Multiply: {
+      bool add = node->op == Opcode::Add;
+      if (add) {
+        m_jit.zero(0);
+      } else {
+        m_jit.loadConstant(0, 1);
+      }
+      for (const Node* child : node->children) {
+        jitOperand(child);
+        m_jit.arith(add ? JitProgram::Arith::Add : JitProgram::Arith::Multiply, 0, 1);
+      }
+      return;
+    }
+    case Opcode::Subtract:
+      jitNode(node->children[0]);
+      if (node->children.size() == 1) {
+        m_jit.flipSign(0, 1);
+        return;
+      }
+      jitOperand(node->children[1]);
+      m_jit.arith(JitProgram::Arith::Subtract, 0, 1);
+      return;
+    default: // Divide
+      jitNode(node->children[0]);
+      jitOperand(node->children[1]);
+      m_jit.arith(JitProgram::Arith::Divide, 0, 1);
+      return;
+  }
+}
+
+// Emit code leaving node's value in xmm1 with xmm0 preserved
+void Interpreter::jitOperand(const Node* node) {
+  if (node->children.empty()) {
+    if (node->data.isNumber()) {
+      m_jit.loadConstant(1, node->data.asNumber());
+    } else {
+      m_jit.loadSlot(1, node->data.asSymbol());
+    }
+    return;
+  }
+  m_jit.push(0);
+  jitNode(node);
+  m_jit.move(1, 0);
+  m_jit.pop(0);
+}
+
+// Run the native code if there is any and every symbol it reads is bound
+// to a number; otherwise the caller falls back to the tree walker, which
+// raises the proper error
+bool Interpreter::runJit(Expression & result) {
+  if (m_jit.empty()) {
+    return false;
+  }
+
+  for (std::size_t i = 0; i < m_jit.slots.size(); ++i) {
+    const Expression* bound = env.lookup(m_jit.slots[i]);
+    if (!bound || !bound->isNumber()) {
+      return false;
+    }
+    m_jitArgs[i] = bound->getNumber();
+  }
+
+  double value = m_jit.run(m_jitArgs.data());
+  if (m_jit.returnsBool) {
+    std::uint64_t mask;
+    std::memcpy(&mask, &value, sizeof(mask));
+    result = Expression(mask != 0);
+  } else {
+    result = Expression(value);
+  }
+
+  if (m_jitVerify) {
+    // Numbers must agree bit for bit, except that any NaN matches any NaN
+    Expression expected = evalExpr(ASTroot);
+    bool same = expected == result;
+    if (expected.isNumber() && result.isNumber()) {
+      double want = expected.getNumber();
+      same = std::memcmp(&want, &value, sizeof(value)) == 0 ||
+             (std::isnan(want) && std::isnan(value));
+    }
+    if (!same) {
+      throw InterpreterSemanticError("JIT result differs from the tree walker");
+    }
+  }
+  return true;
+}
@@ -0,0 +1,83 @@
+// Native code module declarations
+#ifndef JIT_HPP
+#define JIT_HPP
+
+// system includes
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <unordered_map>
+#include <vector>
+
+// module includes
+#include "symbol_table.hpp"
+
+// x86-64 machine code for one numeric expression tree, built with scalar
+// SSE2 instructions and run from its own executable pages. The generated
+// function is
+//
+//   double f(const double* slots, const double* constants)
+//
+// where slots holds the current numeric value of every symbol the tree
+// reads, in the order of the slots member. Intermediate results live in
+// xmm0 and xmm1 and are spilled to the machine stack.
+class JitProgram {
+public:
+  JitProgram() noexcept;
+  ~JitProgram();
+
+  JitProgram(const JitProgram&) = delete;
+  JitProgram& operator=(const JitProgram&) = delete;
+
+  // True when this build can generate and run native code
+  static bool supported() noexcept;
+
+  // Symbol read through each entry of the slots argument
+  std::vector<SymbolId> slots;
+
+  // The result is a comparison mask (all ones or zero) rather than a number
+  bool returnsBool = false;
+
+  // True until finalize() has produced runnable code
+  bool empty() const noexcept { return m_function == nullptr; }
+
+  // Drop the code, constants and slots
+  void clear() noexcept;
+
+  // Instruction emitters; register arguments are xmm register numbers 0-7
+  enum class Arith : std::uint8_t { Add = 0x58, Multiply = 0x59, Subtract = 0x5C, Divide = 0x5E };
+  enum class Predicate : std::uint8_t { Equal = 0, Less = 1, LessEqual = 2 };
+
+  void loadSlot(int xmm, SymbolId symbol);
+  void loadConstant(int xmm, double value);
+  void zero(int xmm);
+  void move(int dst, int src);
+  void flipSign(int xmm, int scratch);
+  void arith(Arith op, int dst, int src);
+  void compare(Predicate predicate, int dst, int src);
+  void push(int xmm);
+  void pop(int xmm);
+  void ret();
+
+  // Copy the emitted code into executable memory. Returns false when
+  // native code is unsupported or the pages cannot be mapped.
+  bool finalize();
+
+  // Run the finalized code
+  double run(const double* slotValues) const noexcept;
+
+private:
+  typedef double (*Function)(const double*, const double*);
+
+  void bytes(std::initializer_list<std::uint8_t> values);
+  void memoryOperand(int xmm, std::uint8_t base, std::uint32_t index);
+
+  std::vector<std::uint8_t> m_code;
+  std::vector<double> m_constants;
+  std::unordered_map<SymbolId, std::uint32_t> m_slotIndex;
+  void* m_memory;
+  std::size_t m_mapped;
+  Function m_function;
+};
+
+#endif
@@ -0,0 +1,24 @@
+// Opcode module declarations
+#ifndef OPCODE_HPP
+#define OPCODE_HPP
+
+// system includes
+#include <cstdint>
+
+// module includes
+#include "symbol_table.hpp"
+
+// Operation named by the head of a list, resolved once at parse time so
+// the evaluators can switch on it instead of comparing symbols
+enum class Opcode : std::uint8_t {
+  Unknown, // head is not a reserved word
+  Not, And, Or, Less, LessEqual, Greater, GreaterEqual, Equal,
+  Add, Subtract, Multiply, Divide, Define, Begin, If
+};
+
+// The reserved words' symbol ids are interned in Opcode order
+inline Opcode opcodeFor(SymbolId id) noexcept {
+  return SymbolTable::isReserved(id) ? static_cast<Opcode>(id + 1) : Opcode::Unknown;
+}
+
+#endif
@@ -0,0 +1,251 @@
+// Constant folding and algebraic simplification of the parsed Node tree
+#include "interpreter.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace {
+
+typedef Interpreter::Node Node;
+
+bool isLiteral(const Node* node) {
+  return node->children.empty() && (node->data.isNumber() || node->data.isBool());
+}
+
+bool isNumber(const Node* node, double value) {
+  return node->children.empty() && node->data.isNumber() && node->data.asNumber() == value;
+}
+
+bool isSymbolLeaf(const Node* node) {
+  return node->children.empty() && node->data.isSymbol();
+}
+
+// Operators whose result depends on nothing but their literal arguments
+bool foldable(Opcode op) {
+  switch (op) {
+    case Opcode::Add:
+    case Opcode::Subtract:
+    case Opcode::Multiply:
+    case Opcode::Divide:
+    case Opcode::Less:
+    case Opcode::LessEqual:
+    case Opcode::Greater:
+    case Opcode::GreaterEqual:
+    case Opcode::Equal:
+    case Opcode::Not:
+    case Opcode::And:
+    case Opcode::Or:
+    case Opcode::Begin:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool comparison(Opcode op) {
+  return op == Opcode::Less || op == Opcode::LessEqual || op == Opcode::Greater ||
+         op == Opcode::GreaterEqual || op == Opcode::Equal;
+}
+
+// Operators that read every argument through numberArg
+bool numeric(Opcode op) {
+  return op == Opcode::Add || op == Opcode::Subtract || op == Opcode::Multiply ||
+         op == Opcode::Divide || comparison(op);
+}
+
+// A node that either raises its own error or yields a number
+bool arithmetic(const Node* node) {
+  return !node->children.empty() && node->data.isSymbol() &&
+         (node->op == Opcode::Add || node->op == Opcode::Subtract ||
+          node->op == Opcode::Multiply || node->op == Opcode::Divide);
+}
+
+// True when number keeps its exact bits as a Value
+bool boxable(double number) {
+  double boxed = Value::number(number).asNumber();
+  return std::memcmp(&boxed, &number, sizeof(number)) == 0;
+}
+
+std::size_t treeSize(const Node* node) {
+  std::size_t size = 0;
+  std::vector<const Node*> pending(1, node);
+  while (!pending.empty()) {
+    const Node* next = pending.back();
+    pending.pop_back();
+    ++size;
+    pending.insert(pending.end(), next->children.begin(), next->children.end());
+  }
+  return size;
+}
+
+// Drop literal arguments equal to identity while more than two remain;
+// returns the number dropped
+std::size_t dropIdentities(Interpreter::NodeList & args, double identity) {
+  std::size_t kept = 0;
+  for (std::size_t i = 0; i < args.count; ++i) {
+    Node* arg = args.items[i];
+    if (isNumber(arg, identity) && args.count - (i - kept) > 2) {
+      continue;
+    }
+    args.items[kept++] = arg;
+  }
+  std::size_t dropped = args.count - kept;
+  args.count = kept;
+  return dropped;
+}
+
+}
+
+std::size_t Interpreter::optimize() {
+  if (!m_program) {
+    return 0;
+  }
+
+  // A parsed Program never changes, and other interpreters may be running
+  // this one: the simplified tree is built in a fresh parse of the same
+  // source, which is loaded in its place
+  std::shared_ptr<Program> program = Program::parse(m_program->source());
+  if (!program) {
+    return 0;
+  }
+  Node* root = program->root();
+
+  // Post-order walk on an explicit stack. Arguments are visited right to
+  // left, so each knows whether those after it are leaves. slot is where
+  // the simplified node goes.
+  struct Pending {
+    Node** slot;
+    Opcode parent;
+    bool tailLeaves;
+    std::size_t next;
+    bool leaves;
+  };
+  std::vector<Pending> stack;
+  std::size_t removed = 0;
+
+  if (!root->children.empty()) {
+    stack.push_back(Pending{&root, Opcode::Unknown, false, root->children.size(), true});
+  }
+  while (!stack.empty()) {
+    Pending & top = stack.back();
+    Node* node = *top.slot;
+    NodeList & args = node->children;
+    if (top.next < args.count) {
+      top.leaves = top.leaves && args[top.next]->children.empty();
+    }
+
+    // A non-symbol head raises "Not a symbol" before its arguments run
+    if (top.next > 0 && node->data.isSymbol()) {
+      Node** slot = &args.items[--top.next];
+      if (!(*slot)->children.empty()) {
+        stack.push_back(Pending{slot, node->op, top.leaves, (*slot)->children.size(), true});
+      }
+      continue;
+    }
+
+    *top.slot = simplifyNode(node, top.parent, top.tailLeaves, removed);
+    stack.pop_back();
+  }
+  program->setRoot(root);
+  load(program);
+  return removed;
+}
+
+// Simplify node, whose arguments are already simplified and whose value
+// is read by an operator of kind parent, and return the node that replaces
+// it. tailLeaves says that every later argument of the parent is a leaf,
+// so evaluating them can neither fail nor define anything.
+//
+// An identity operand may only be dropped where the result and any error
+// stay the same:
+//   - literal 0 terms and 1 factors go while two arguments remain, since
+//     sums start from +0 and products from 1 in applyOp;
+//   - (* e 1), (/ e 1) and (- e 0) become e when e is an arithmetic node,
+//     or a symbol read as a number by the parent with nothing left to
+//     evaluate after it, so that an unbound or non-numeric symbol still
+//     raises "Expected number";
+//   - (+ e 0) turns -0 into +0, so it becomes e only under + or a
+//     comparison, where the sign of zero cannot be observed.
+Interpreter::Node* Interpreter::simplifyNode(Node* node, Opcode parent, bool tailLeaves,
+                                             std::size_t & removed) {
+  if (node->children.empty() || !node->data.isSymbol()) {
+    return node;
+  }
+
+  NodeList & args = node->children;
+  if (node->op == Opcode::If) {
+    if (args.count >= 3 && isLiteral(args[0]) && args[0]->data.isBool()) {
+      Node* branch = args[args[0]->data.asBool() ? 1 : 2];
+      removed += treeSize(node) - treeSize(branch);
+      return branch;
+    }
+    return node;
+  }
+
+  if (foldable(node->op)) {
+    bool constant = true;
+    for (const Node* arg : args) {
+      constant = constant && isLiteral(arg);
+    }
+    if (constant) {
+      try {
+        Expression result = evalExpr(node);
+        if ((result.isNumber() && boxable(result.getNumber())) || result.isBool()) {
+          removed += args.count;
+          node->data = toValue(result);
+          node->op = Opcode::Unknown;
+          node->children = NodeList();
+          return node;
+        }
+      } catch (const InterpreterSemanticError &) {
+        // left for eval() to raise
+      }
+      return node;
+    }
+  }
+
+  Node* operand = nullptr;
+  switch (node->op) {
+    case Opcode::Add:
+      removed += dropIdentities(args, 0);
+      if (args.count == 2 && (parent == Opcode::Add || comparison(parent))) {
+        if (isNumber(args[1], 0)) {
+          operand = args[0];
+        } else if (isNumber(args[0], 0)) {
+          operand = args[1];
+        }
+      }
+      break;
+    case Opcode::Multiply:
+      removed += dropIdentities(args, 1);
+      if (args.count == 2) {
+        if (isNumber(args[1], 1)) {
+          operand = args[0];
+        } else if (isNumber(args[0], 1)) {
+          operand = args[1];
+        }
+      }
+      break;
+    case Opcode::Subtract:
+      if (args.count == 2 && isNumber(args[1], 0) && !std::signbit(args[1]->data.asNumber())) {
+        operand = args[0];
+      }
+      break;
+    case Opcode::Divide:
+      if (args.count == 2 && isNumber(args[1], 1)) {
+        operand = args[0];
+      }
+      break;
+    default:
+      break;
+  }
+
+  if (operand && (arithmetic(operand) ||
+                  (isSymbolLeaf(operand) && numeric(parent) && tailLeaves))) {
+    removed += 2;
+    return operand;
+  }
+  return node;
+}
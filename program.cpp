@@ -0,0 +1,280 @@
+// Program module implementation
+#include "program.hpp"
+#include "interpreter_semantic_error.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <iterator>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+std::shared_ptr<Program> Program::parse(std::istream & input) noexcept {
+  try {
+    return parse(std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()));
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+std::shared_ptr<Program> Program::parse(const std::string & source) noexcept {
+  try {
+    return parse(std::string(source));
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+std::shared_ptr<Program> Program::parse(std::string && source) noexcept {
+  try {
+    std::shared_ptr<Program> program(new Program());
+    program->m_source = std::move(source);
+    auto tokens = program->tokenize(program->m_source);
+
+    // Require at least one opening paren
+    if (tokens.empty() || tokens.front().kind != TokenKind::Open) {
+      return nullptr;
+    }
+
+    std::size_t pos = 0;
+    Node* root = program->ASTtree(tokens, pos);
+
+    // Check for extra input
+    if (pos != tokens.size() || program->m_begin_count > 2) {
+      return nullptr;
+    }
+
+    program->m_root = root;
+    program->m_pending = std::vector<Node*>();
+    program->numberSlots();
+    return program;
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+std::vector<Program::Token> Program::tokenize(const std::string & str) const {
+  std::vector<Token> tokens;
+  std::size_t tokenStart = 0;
+  std::size_t tokenLength = 0;
+  bool inComment = false;
+
+  for (std::size_t i = 0; i < str.size(); ++i) {
+    char ch = str[i];
+    if (ch == '\n') {
+      inComment = false; // end of comment
+    }
+
+    if (inComment) {
+      continue; // skip characters in comment
+    }
+
+    if (ch == ';' || isspace(static_cast<unsigned char>(ch)) || ch == '(' || ch == ')') {
+      if (tokenLength != 0) {
+        tokens.push_back(Token{TokenKind::Atom, tokenStart, tokenLength});
+        tokenLength = 0;
+      }
+      if (ch == ';') {
+        inComment = true; // start skipping
+      } else if (ch == '(') {
+        tokens.push_back(Token{TokenKind::Open, i, 1});
+      } else if (ch == ')') {
+        tokens.push_back(Token{TokenKind::Close, i, 1});
+      }
+    } else {
+      if (tokenLength == 0) {
+        tokenStart = i;
+      }
+      ++tokenLength;
+    }
+  }
+
+  if (tokenLength != 0) {
+    tokens.push_back(Token{TokenKind::Atom, tokenStart, tokenLength});
+  }
+
+  return tokens;
+}
+
+std::string Program::tokenText(const Token & token) const {
+  return m_source.substr(token.offset, token.length);
+}
+
+// Convert an atom token to a number, boolean, or interned symbol
+Value Program::buildAtom(const Token & current) {
+  std::string token = tokenText(current);
+  if (token == "True") return Value::boolean(true);
+  if (token == "False") return Value::boolean(false);
+
+  if (token == "pi") return Value::number(std::atan2(0, -1));
+
+  if (isValidSymbol(token)) {
+    return Value::symbol(intern(token));
+  }
+
+  std::size_t idx = 0;
+  double number = 0;
+  try {
+    number = std::stod(token, &idx);
+  } catch (...) {
+    idx = 0;
+  }
+  if (idx == 0 || idx < token.length()) {
+    throw InterpreterSemanticError("Invalid token: " + token);
+  }
+  return Value::number(number);
+}
+
+// Parser from token list straight to the evaluable Node tree; pos is the
+// cursor into tokens and is advanced past everything consumed. Lists still
+// open are kept on an explicit stack, so nesting depth is limited by the
+// heap rather than the native stack.
+Program::Node* Program::ASTtree(const std::vector<Token> & tokens, std::size_t & pos) {
+  if (pos >= tokens.size()) {
+    throw InterpreterSemanticError("Unexpected end of input");
+  }
+
+  // Each open list with the position of its first child in m_pending
+  struct OpenList {
+    Node* node;
+    std::size_t first;
+  };
+  std::vector<OpenList> open;
+
+  for (;;) {
+    const Token & current = tokens[pos++];
+    if (current.kind == TokenKind::Close) {
+      throw InterpreterSemanticError("Unexpected ')'");
+    }
+
+    Node* done = nullptr;
+    if (current.kind == TokenKind::Atom) {
+      done = newAtomNode(current);
+    } else {
+      // List: the head must be an atom, e.g. ( ) and (( ... ) ...) are invalid
+      if (pos >= tokens.size()) {
+        throw InterpreterSemanticError("Expected expression after '('");
+      }
+      if (tokens[pos].kind != TokenKind::Atom) {
+        throw InterpreterSemanticError("Empty expression is invalid");
+      }
+      open.push_back(OpenList{newAtomNode(tokens[pos++]), m_pending.size()});
+      m_depth = std::max(m_depth, open.size());
+    }
+
+    // Hand each finished expression to the list it belongs to, closing
+    // lists until one has another child to parse
+    for (;;) {
+      if (done) {
+        if (open.empty()) {
+          return done;
+        }
+        m_pending.push_back(done);
+      }
+      if (pos < tokens.size() && tokens[pos].kind != TokenKind::Close) {
+        break;
+      }
+      if (pos >= tokens.size()) {
+        throw InterpreterSemanticError("Missing closing ')'");
+      }
+      ++pos; // consume ')'
+
+      done = open.back().node;
+      std::size_t first = open.back().first;
+      open.pop_back();
+
+      std::size_t count = m_pending.size() - first;
+      if (count != 0) {
+        done->children.items = m_nodes.allocateArray<Node*>(count);
+        done->children.count = count;
+        std::copy(m_pending.begin() + first, m_pending.end(), done->children.items);
+        m_pending.resize(first);
+      }
+    }
+  }
+}
+
+static_assert(std::is_trivially_destructible<Program::Node>::value,
+              "releasing the node arena must not need destructor calls");
+
+Program::Node* Program::newAtomNode(const Token & token) {
+  Node* node = m_nodes.create<Node>(buildAtom(token));
+  if (node->data.isSymbol()) {
+    node->op = opcodeFor(node->data.asSymbol());
+    if (node->op == Opcode::Begin) {
+      m_begin_count++;
+    }
+  }
+  return node;
+}
+
+bool Program::isValidSymbol(const std::string & token) {
+  static const std::unordered_set<std::string> specialForms = {
+    "not", "and", "or", "<", "<=", ">", ">=", "=", "+", "-", "*", "/", "define", "begin", "if"
+  };
+
+  // Rule 4: Not a reserved keyword or special form
+  if (specialForms.count(token)) {
+    return true;
+  }
+
+  // Rule 1: No whitespace
+  if (token.find_first_of(" \t\n\r") != std::string::npos) {
+    return false;
+  }
+
+  // Rule 3: Must not start with a digit
+  if (!token.empty() && std::isdigit(token[0])) {
+    return false;
+  }
+
+  // Rule 2: Must not be parseable as a number
+  char* endptr = nullptr;
+  std::strtod(token.c_str(), &endptr);
+  if (*endptr == '\0') {
+    // Entire token was parsed as a valid number
+    return false;
+  }
+
+  // Otherwise, it’s a valid user-defined symbol
+  return true;
+}
+
+// Number the symbols read through slots; see slotSymbols()
+void Program::numberSlots() {
+  std::unordered_map<SymbolId, std::uint32_t> numbers;
+  auto number = [this, &numbers](SymbolId id) {
+    auto found = numbers.emplace(id, static_cast<std::uint32_t>(m_slotSymbols.size()));
+    if (found.second) {
+      m_slotSymbols.push_back(id);
+    }
+    return found.first->second;
+  };
+
+  std::vector<Node*> pending(1, m_root);
+  while (!pending.empty()) {
+    Node* node = pending.back();
+    pending.pop_back();
+    if (node->children.empty() || !node->data.isSymbol()) {
+      continue;
+    }
+
+    // Not through Divide are contiguous in Opcode
+    bool readsArguments = node->op >= Opcode::Not && node->op <= Opcode::Divide;
+    for (Node* child : node->children) {
+      if (!child->children.empty()) {
+        pending.push_back(child);
+      } else if (readsArguments && child->data.isSymbol()) {
+        child->slot = number(child->data.asSymbol());
+      }
+    }
+
+    Node* name = node->children[0];
+    if (node->op == Opcode::Define && name->children.empty() && name->data.isSymbol()) {
+      number(name->data.asSymbol());
+    }
+  }
+}
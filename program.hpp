@@ -0,0 +1,116 @@
+// Program module declarations
+#ifndef PROGRAM_HPP
+#define PROGRAM_HPP
+
+// system includes
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// module includes
+#include "arena.hpp"
+#include "opcode.hpp"
+#include "symbol_table.hpp"
+#include "value.hpp"
+
+// A parsed program: the evaluable Node tree and the source it was parsed
+// from. Nothing changes a Program once it is parsed, so one program can
+// be shared as a std::shared_ptr<const Program> and evaluated by any
+// number of interpreters, on any threads, at the same time; all state of
+// an evaluation lives in the Interpreter running it.
+class Program {
+public:
+  // Parse source text; nullptr when it is not a valid program. The
+  // program keeps the source, moved in from an rvalue.
+  static std::shared_ptr<Program> parse(std::istream & input) noexcept;
+  static std::shared_ptr<Program> parse(const std::string & source) noexcept;
+  static std::shared_ptr<Program> parse(std::string && source) noexcept;
+
+  Program(const Program&) = delete;
+  Program& operator=(const Program&) = delete;
+
+  // Lightweight token record: a (kind, offset, length) view into the source
+  enum class TokenKind { Open, Close, Atom };
+
+  struct Token {
+    TokenKind kind;
+    std::size_t offset;
+    std::size_t length;
+  };
+
+  struct Node;
+
+  // Fixed array of child pointers stored in the node arena
+  struct NodeList {
+    Node** items = nullptr;
+    std::size_t count = 0;
+
+    Node** begin() const { return items; }
+    Node** end() const { return items + count; }
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    Node* operator[](std::size_t i) const { return items[i]; }
+  };
+
+  struct Node {
+    Value data;
+    Opcode op = Opcode::Unknown; // resolved from data when it is a symbol
+    std::uint32_t slot = NoSlot; // index into slotSymbols() of a symbol argument
+    NodeList children;
+
+    static const std::uint32_t NoSlot = 0xFFFFFFFFu;
+
+    Node(Value atom) : data(atom) {}
+
+    // Nodes and their child arrays live in the Program's arena and are
+    // released together with it; both are trivially destructible, so
+    // releasing a tree is O(1)
+  };
+
+  Node* root() const noexcept { return m_root; }
+  const std::string & source() const noexcept { return m_source; }
+
+  // Deepest list nesting
+  std::size_t depth() const noexcept { return m_depth; }
+
+  // Lexical addressing. Every symbol that not, and, or, the comparisons or
+  // the arithmetic operators read as an argument is numbered, and so is
+  // every name define binds; a Node's slot is the index of its symbol here.
+  // An interpreter maps these onto slots of its own environment.
+  const std::vector<SymbolId> & slotSymbols() const noexcept { return m_slotSymbols; }
+
+private:
+  // Interpreter::optimize simplifies the tree of a fresh parse before it
+  // loads, and so shares, that program
+  friend class Interpreter;
+
+  Program() : m_root(nullptr) {}
+
+  // Replace the tree of a program not yet shared, by one built from nodes
+  // of this program's arena
+  void setRoot(Node* root) noexcept { m_root = root; }
+
+  std::vector<Token> tokenize(const std::string & str) const;
+  std::string tokenText(const Token & token) const;
+  Value buildAtom(const Token & token);
+  Node* ASTtree(const std::vector<Token> & tokens, std::size_t & pos);
+  Node* newAtomNode(const Token & token);
+  void numberSlots();
+  bool isValidSymbol(const std::string & token);
+
+  std::string m_source;
+  Arena m_nodes;
+  Node* m_root;
+  std::size_t m_depth = 0;
+  std::vector<SymbolId> m_slotSymbols;
+  int m_begin_count = 0;
+
+  // Children of the lists currently being parsed, copied into the arena
+  // once each list is closed
+  std::vector<Node*> m_pending;
+};
+
+#endif
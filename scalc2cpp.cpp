@@ -0,0 +1,50 @@
+// Ahead-of-time transpiler
+//
+// Usage: scalc2cpp <program file> [output file]
+//
+// Parses the program and writes a standalone C++ translation unit that
+// prints the program's result, or reports its evaluation error, exactly
+// as the interpreters would. Without an output file the code goes to
+// standard output.
+#include "interpreter.hpp"
+#include "interpreter_semantic_error.hpp"
+
+#include <fstream>
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+  if (argc != 2 && argc != 3) {
+    std::cerr << "Usage: scalc2cpp <program file> [output file]\n";
+    return 1;
+  }
+
+  std::ifstream file(argv[1]);
+  if (!file) {
+    std::cerr << "Error: Cannot open file " << argv[1] << "\n";
+    return 1;
+  }
+
+  Interpreter interp;
+  if (!interp.parse(file)) {
+    std::cerr << "Failed to parse file" << std::endl;
+    return 1;
+  }
+
+  try {
+    if (argc == 2) {
+      interp.transpile(std::cout);
+      return 0;
+    }
+
+    std::ofstream out(argv[2]);
+    if (!out) {
+      std::cerr << "Error: Cannot write file " << argv[2] << "\n";
+      return 1;
+    }
+    interp.transpile(out);
+    return out ? 0 : 1;
+  } catch (const InterpreterSemanticError & e) {
+    std::cerr << "Error: Transpile failed: " << e.what() << "\n";
+    return 1;
+  }
+}
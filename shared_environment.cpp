@@ -0,0 +1,35 @@
+// Shared environment module implementation
+#include "shared_environment.hpp"
+
+#include <memory>
+#include <utility>
+
+const std::size_t SharedEnvironment::MaxDepth;
+
+SharedEnvironment::SharedEnvironment()
+  : SharedEnvironment(std::make_shared<const Environment>()) {}
+
+SharedEnvironment::SharedEnvironment(EnvironmentSnapshot initial)
+  : m_current(std::move(initial)), m_version(1) {}
+
+EnvironmentSnapshot SharedEnvironment::current(std::uint64_t* version) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (version) {
+    *version = m_version.load(std::memory_order_relaxed);
+  }
+  return m_current;
+}
+
+void SharedEnvironment::publish(const Environment & changes) {
+  Environment flat = changes.flattened();
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::shared_ptr<Environment> next = std::make_shared<Environment>(m_current);
+  next->symbols = std::move(flat.symbols);
+  if (next->depth() > MaxDepth) {
+    // Lookups walk the layers, so keep them few
+    next = std::make_shared<Environment>(next->flattened());
+  }
+  m_current = std::move(next);
+  m_version.fetch_add(1, std::memory_order_release);
+}
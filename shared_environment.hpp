@@ -0,0 +1,49 @@
+// Shared environment module declarations
+#ifndef SHARED_ENVIRONMENT_HPP
+#define SHARED_ENVIRONMENT_HPP
+
+// system includes
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+// module includes
+#include "environment.hpp"
+
+// Bindings read by any number of interpreters on any threads and updated
+// now and then, RCU style. Each published version is an immutable
+// EnvironmentSnapshot: an interpreter evaluates against the version it
+// holds without synchronization, and notices a newer one with a single
+// atomic load of the version number. Publishing adds a layer over the
+// current version, so readers keep theirs alive until they move on, and
+// the layers are flattened once there are more than MaxDepth of them.
+// Publishers are serialized by a mutex that readers take only to pick up
+// a new version.
+class SharedEnvironment {
+public:
+  SharedEnvironment();
+  explicit SharedEnvironment(EnvironmentSnapshot initial);
+
+  SharedEnvironment(const SharedEnvironment&) = delete;
+  SharedEnvironment& operator=(const SharedEnvironment&) = delete;
+
+  // Number of the current version, starting at 1
+  std::uint64_t version() const noexcept { return m_version.load(std::memory_order_acquire); }
+
+  // The current version, and its number in *version if given
+  EnvironmentSnapshot current(std::uint64_t* version = nullptr) const;
+
+  // Publish a new version where every binding visible in changes replaces
+  // or adds to those of the current one
+  void publish(const Environment & changes);
+
+  static const std::size_t MaxDepth = 8;
+
+private:
+  mutable std::mutex m_mutex;
+  EnvironmentSnapshot m_current;
+  std::atomic<std::uint64_t> m_version;
+};
+
+#endif
@@ -0,0 +1,102 @@
+// Symbol map module implementation
+#include "symbol_map.hpp"
+
+#include <utility>
+
+SymbolMap::SymbolMap(SymbolMap && other) noexcept
+  : m_entries(std::move(other.m_entries)), m_size(other.m_size), m_shift(other.m_shift) {
+  other.clear();
+}
+
+SymbolMap& SymbolMap::operator=(SymbolMap && other) noexcept {
+  if (this != &other) {
+    m_entries = std::move(other.m_entries);
+    m_size = other.m_size;
+    m_shift = other.m_shift;
+    other.clear();
+  }
+  return *this;
+}
+
+const Expression* SymbolMap::find(SymbolId id) const noexcept {
+  if (m_size == 0) {
+    return nullptr;
+  }
+  std::size_t mask = m_entries.size() - 1;
+  for (std::size_t slot = home(id);; slot = (slot + 1) & mask) {
+    const Entry & entry = m_entries[slot];
+    if (entry.key == id) {
+      return &entry.value;
+    }
+    if (entry.key == Empty) {
+      return nullptr;
+    }
+  }
+}
+
+Expression* SymbolMap::find(SymbolId id) noexcept {
+  return const_cast<Expression*>(static_cast<const SymbolMap*>(this)->find(id));
+}
+
+void SymbolMap::assign(SymbolId id, const Expression & value) {
+  if ((m_size + 1) * 4 > m_entries.size() * 3) {
+    rehash(m_entries.empty() ? 16 : m_entries.size() * 2);
+  }
+  std::size_t mask = m_entries.size() - 1;
+  for (std::size_t slot = home(id);; slot = (slot + 1) & mask) {
+    Entry & entry = m_entries[slot];
+    if (entry.key == id) {
+      entry.value = value;
+      return;
+    }
+    if (entry.key == Empty) {
+      entry.key = id;
+      entry.value = value;
+      ++m_size;
+      return;
+    }
+  }
+}
+
+void SymbolMap::reserve(std::size_t count) {
+  std::size_t capacity = 16;
+  while (count * 4 > capacity * 3) {
+    capacity *= 2;
+  }
+  if (capacity > m_entries.size()) {
+    rehash(capacity);
+  }
+}
+
+void SymbolMap::clear() noexcept {
+  m_entries.clear();
+  m_size = 0;
+  m_shift = 64;
+}
+
+// Move every binding into a new array of capacity entries, a power of two
+void SymbolMap::rehash(std::size_t capacity) {
+  std::vector<Entry> old(capacity);
+  old.swap(m_entries);
+  for (Entry & entry : m_entries) {
+    entry.key = Empty;
+  }
+
+  m_shift = 64;
+  for (std::size_t size = capacity; size > 1; size /= 2) {
+    --m_shift;
+  }
+
+  std::size_t mask = capacity - 1;
+  for (Entry & entry : old) {
+    if (entry.key == Empty) {
+      continue;
+    }
+    std::size_t slot = home(entry.key);
+    while (m_entries[slot].key != Empty) {
+      slot = (slot + 1) & mask;
+    }
+    m_entries[slot].key = entry.key;
+    m_entries[slot].value = std::move(entry.value);
+  }
+}
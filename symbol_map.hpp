@@ -0,0 +1,77 @@
+// Symbol map module declarations
+#ifndef SYMBOL_MAP_HPP
+#define SYMBOL_MAP_HPP
+
+// system includes
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// module includes
+#include "expression.hpp"
+#include "symbol_table.hpp"
+
+// Open-addressing hash table from interned symbol ids to Expressions.
+//
+// Entries live inline in one power-of-two array and collisions are
+// resolved by linear probing, so a lookup hashes the id once and then
+// reads consecutive entries; its cost does not grow with the number of
+// bindings. Ids are spread over the array by Fibonacci hashing. Bindings
+// are never removed, so probe sequences need no tombstones. The table
+// grows by doubling before it is three quarters full.
+class SymbolMap {
+public:
+  struct Entry {
+    SymbolId key;
+    Expression value;
+  };
+
+  SymbolMap() noexcept : m_size(0), m_shift(64) {}
+
+  SymbolMap(const SymbolMap&) = default;
+  SymbolMap& operator=(const SymbolMap&) = default;
+
+  // A moved-from map is empty
+  SymbolMap(SymbolMap && other) noexcept;
+  SymbolMap& operator=(SymbolMap && other) noexcept;
+
+  std::size_t size() const noexcept { return m_size; }
+  bool empty() const noexcept { return m_size == 0; }
+
+  // The value bound to id, or nullptr
+  const Expression* find(SymbolId id) const noexcept;
+  Expression* find(SymbolId id) noexcept;
+
+  // Bind id to value, replacing any previous binding
+  void assign(SymbolId id, const Expression & value);
+
+  // Make room for count bindings without growing
+  void reserve(std::size_t count);
+
+  void clear() noexcept;
+
+  // Call visit(id, value) for every binding, in no particular order
+  template <typename Visit>
+  void forEach(Visit visit) const {
+    for (const Entry & entry : m_entries) {
+      if (entry.key != Empty) {
+        visit(entry.key, entry.value);
+      }
+    }
+  }
+
+private:
+  static const SymbolId Empty = 0xFFFFFFFFu;
+
+  std::size_t home(SymbolId id) const noexcept {
+    return static_cast<std::size_t>((id * 0x9E3779B97F4A7C15ull) >> m_shift);
+  }
+
+  void rehash(std::size_t capacity);
+
+  std::vector<Entry> m_entries;
+  std::size_t m_size;
+  unsigned m_shift; // 64 - log2(capacity)
+};
+
+#endif
@@ -0,0 +1,39 @@
+// Symbol table module implementation
+#include "symbol_table.hpp"
+
+SymbolTable & SymbolTable::global() {
+  static SymbolTable table;
+  return table;
+}
+
+SymbolTable::SymbolTable() {
+  static const char* reserved[Sym::ReservedCount] = {
+    "not", "and", "or", "<", "<=", ">", ">=", "=",
+    "+", "-", "*", "/", "define", "begin", "if"
+  };
+  for (const char* word : reserved) {
+    intern(word);
+  }
+}
+
+SymbolId SymbolTable::intern(const std::string & name) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_ids.find(name);
+  if (it != m_ids.end()) {
+    return it->second;
+  }
+  SymbolId id = static_cast<SymbolId>(m_names.size());
+  m_names.push_back(name);
+  m_ids.emplace(name, id);
+  return id;
+}
+
+const std::string & SymbolTable::name(SymbolId id) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_names[id];
+}
+
+std::size_t SymbolTable::size() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_names.size();
+}
@@ -0,0 +1,54 @@
+// Symbol table module declarations
+#ifndef SYMBOL_TABLE_HPP
+#define SYMBOL_TABLE_HPP
+
+// system includes
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+typedef std::uint32_t SymbolId;
+
+// Ids of the reserved words. The symbol table interns them first, in this
+// order, so they can be compared as constants.
+namespace Sym {
+enum : SymbolId {
+  Not, And, Or, Less, LessEqual, Greater, GreaterEqual, Equal,
+  Add, Subtract, Multiply, Divide, Define, Begin, If,
+  ReservedCount
+};
+}
+
+// Process-wide intern table mapping symbol names to dense 32-bit ids.
+// Each name is stored once; ids are never reused, and names returned by
+// name() stay valid for the life of the process.
+class SymbolTable {
+public:
+  static SymbolTable & global();
+
+  SymbolId intern(const std::string & name);
+  const std::string & name(SymbolId id) const;
+  std::size_t size() const;
+
+  static bool isReserved(SymbolId id) noexcept { return id < Sym::ReservedCount; }
+
+private:
+  SymbolTable();
+
+  mutable std::mutex m_mutex;
+  std::deque<std::string> m_names; // deque: growing never moves a name
+  std::unordered_map<std::string, SymbolId> m_ids;
+};
+
+// Shorthands for the global table
+inline SymbolId intern(const std::string & name) {
+  return SymbolTable::global().intern(name);
+}
+
+inline const std::string & symbolName(SymbolId id) {
+  return SymbolTable::global().name(id);
+}
+
+#endif
@@ -0,0 +1,679 @@
+// Transpiler module implementation: writes a parsed program as a standalone
+// C++ translation unit
+#include "interpreter.hpp"
+#include "interpreter_semantic_error.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+typedef Interpreter::Node Node;
+
+// Runtime shared by every generated program. It mirrors the Expression
+// types and the environment checks of Interpreter::applyOp.
+const char* const runtimeHead =
+  "#include <cstdint>\n"
+  "#include <cstdlib>\n"
+  "#include <cstring>\n"
+  "#include <iostream>\n"
+  "#include <stdexcept>\n"
+  "#include <string>\n"
+  "\n"
+  "namespace scalc {\n"
+  "\n"
+  "struct Error : std::runtime_error {\n"
+  "  explicit Error(const std::string & message) : std::runtime_error(message) {}\n"
+  "};\n"
+  "\n"
+  "enum class Type { None, Boolean, Number, Symbol };\n"
+  "\n"
+  "struct Value {\n"
+  "  Type type;\n"
+  "  double number;\n"
+  "  bool boolean;\n"
+  "  int symbol;\n"
+  "};\n"
+  "\n"
+  "inline Value number(double x) { Value v = {Type::Number, x, false, 0}; return v; }\n"
+  "inline Value boolean(bool b) { Value v = {Type::Boolean, 0, b, 0}; return v; }\n"
+  "inline Value symbol(int id) { Value v = {Type::Symbol, 0, false, id}; return v; }\n"
+  "\n"
+  "inline double fromBits(std::uint64_t bits) {\n"
+  "  double x;\n"
+  "  std::memcpy(&x, &bits, sizeof(x));\n"
+  "  return x;\n"
+  "}\n"
+  "\n"
+  "[[noreturn]] inline void fail(const std::string & message) { throw Error(message); }\n"
+  "\n"
+  "// Store the result of an if branch\n"
+  "inline void set(double & result, double x) { result = x; }\n"
+  "inline void set(bool & result, bool b) { result = b; }\n"
+  "inline void set(Value & result, double x) { result = number(x); }\n"
+  "inline void set(Value & result, bool b) { result = boolean(b); }\n"
+  "inline void set(Value & result, const Value & v) { result = v; }\n"
+  "\n";
+
+const char* const runtimeEnvironment =
+  "\n"
+  "struct Environment {\n"
+  "  Value value[symbolCount];\n"
+  "  bool bound[symbolCount];\n"
+  "};\n"
+  "\n"
+  "inline Value lookup(const Environment & env, int id) {\n"
+  "  if (!env.bound[id]) fail(std::string(\"Undefined symbol: \") + symbolNames[id]);\n"
+  "  return env.value[id];\n"
+  "}\n"
+  "\n"
+  "inline double numberOf(const Environment & env, int id) {\n"
+  "  if (!env.bound[id] || env.value[id].type != Type::Number) fail(\"Expected number\");\n"
+  "  return env.value[id].number;\n"
+  "}\n"
+  "\n"
+  "inline double numberArg(const Environment & env, const Value & arg) {\n"
+  "  if (arg.type == Type::Number) return arg.number;\n"
+  "  if (arg.type != Type::Symbol) fail(\"Expected number\");\n"
+  "  return numberOf(env, arg.symbol);\n"
+  "}\n"
+  "\n"
+  "inline bool boolOf(const Environment & env, int id) {\n"
+  "  if (!env.bound[id] || env.value[id].type != Type::Boolean) fail(\"Expected bool\");\n"
+  "  return env.value[id].boolean;\n"
+  "}\n"
+  "\n"
+  "inline bool boolArg(const Environment & env, const Value & arg) {\n"
+  "  if (arg.type == Type::Boolean) return arg.boolean;\n"
+  "  if (arg.type != Type::Symbol) fail(\"Expected bool\");\n"
+  "  return boolOf(env, arg.symbol);\n"
+  "}\n"
+  "\n"
+  "inline bool condition(const Value & arg) {\n"
+  "  if (arg.type != Type::Boolean) fail(\"Not a boolean\");\n"
+  "  return arg.boolean;\n"
+  "}\n"
+  "\n"
+  "inline Value begin(const Environment & env, const Value & last) {\n"
+  "  return last.type == Type::Symbol ? lookup(env, last.symbol) : last;\n"
+  "}\n"
+  "\n"
+  "inline Value define(Environment & env, const Value & name, const Value & value) {\n"
+  "  if (name.type != Type::Symbol) fail(\"Expected conditional\");\n"
+  "  int variable = unnamed;\n"
+  "  Value bound = name;\n"
+  "  if (value.type == Type::Boolean || value.type == Type::Number) {\n"
+  "    bound = value;\n"
+  "    variable = name.symbol;\n"
+  "  } else if (value.type == Type::Symbol) {\n"
+  "    if (env.bound[value.symbol]) {\n"
+  "      bound = env.value[value.symbol];\n"
+  "      variable = name.symbol;\n"
+  "    } else {\n"
+  "      std::cout << \"not found\";\n"
+  "    }\n"
+  "  }\n"
+  "  if (symbolReserved[variable] || env.bound[variable]) fail(\"Cant define such names\");\n"
+  "  env.value[variable] = bound;\n"
+  "  env.bound[variable] = true;\n"
+  "  return bound;\n"
+  "}\n"
+  "\n"
+  "inline std::ostream & operator<<(std::ostream & out, const Value & value) {\n"
+  "  switch (value.type) {\n"
+  "    case Type::Number: return out << value.number;\n"
+  "    case Type::Boolean: return out << (value.boolean ? \"true\" : \"false\");\n"
+  "    case Type::Symbol: return out << symbolNames[value.symbol];\n"
+  "    default: return out << \"None\";\n"
+  "  }\n"
+  "}\n"
+  "\n";
+
+const char* const runtimeMain =
+  "\n"
+  "} // namespace scalc\n"
+  "\n"
+  "#ifndef SCALC_NO_MAIN\n"
+  "int main() {\n"
+  "  try {\n"
+  "    std::cout << scalc::program() << std::endl;\n"
+  "  } catch (const scalc::Error & err) {\n"
+  "    std::cerr << \"Evaluation error: \" << err.what() << std::endl;\n"
+  "    return EXIT_FAILURE;\n"
+  "  }\n"
+  "  return EXIT_SUCCESS;\n"
+  "}\n"
+  "#endif\n";
+
+// C++ string literal for text
+std::string quote(const std::string & text) {
+  std::string out = "\"";
+  for (unsigned char ch : text) {
+    if (ch == '"' || ch == '\\' || ch == '?') {
+      out += '\\';
+      out += static_cast<char>(ch);
+    } else if (ch < 0x20 || ch >= 0x7F) {
+      char escape[8];
+      std::snprintf(escape, sizeof(escape), "\\%03o", ch);
+      out += escape;
+    } else {
+      out += static_cast<char>(ch);
+    }
+  }
+  return out + "\"";
+}
+
+// C++ expression with exactly the value num, signed zeros and NaNs included
+std::string numberLiteral(double num) {
+  if (num == 0 || !std::isfinite(num)) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &num, sizeof(bits));
+    char text[40];
+    std::snprintf(text, sizeof(text), "fromBits(0x%016llxull)", static_cast<unsigned long long>(bits));
+    return text;
+  }
+  char text[40];
+  std::snprintf(text, sizeof(text), "%.17g", num);
+  std::string literal = text;
+  if (literal.find_first_of(".e") == std::string::npos) {
+    literal += ".0";
+  }
+  return literal;
+}
+
+// What the generator knows about a node's value. Number and Boolean
+// operands are C++ expressions of type double and bool, Symbol operands
+// are a known symbol, Dynamic operands are a Value temporary, and Failed
+// operands always raise an error before producing anything.
+struct Operand {
+  enum Kind { Number, Boolean, Symbol, Dynamic, Failed };
+
+  Kind kind;
+  std::string code;
+  int symbol;
+
+  static Operand of(Kind kind, const std::string & code, int symbol = 0) {
+    Operand operand;
+    operand.kind = kind;
+    operand.code = code;
+    operand.symbol = symbol;
+    return operand;
+  }
+};
+
+// Generates the body of scalc::program() as one flat sequence of
+// statements. Temporaries are declared up front and if, and and or jump to
+// labels instead of nesting blocks, so the output grows linearly with the
+// program however deeply it is nested. The tree is walked on an explicit
+// stack of frames, like the evaluators do, so deep programs cannot
+// exhaust the native stack.
+class CppWriter {
+public:
+  explicit CppWriter(std::ostream & out)
+    : m_out(out), m_temps(0), m_labels(0), m_usesEnv(false) {}
+
+  void program(const Node* root) {
+    symbolIndex(intern(""));
+    Operand result = generate(root);
+    std::string value = result.kind == Operand::Failed ? "Value()" : valueOf(result);
+
+    m_out << "// Generated by scalc2cpp. Evaluates the program with the semantics\n"
+          << "// and errors of Interpreter::eval; build with -DSCALC_NO_MAIN to use\n"
+          << "// scalc::program() from other code.\n"
+          << runtimeHead;
+
+    m_out << "const int symbolCount = " << m_symbols.size() << ";\n"
+          << "const char* const symbolNames[symbolCount] = {";
+    for (std::size_t i = 0; i < m_symbols.size(); ++i) {
+      m_out << (i ? ", " : "") << quote(symbolName(m_symbols[i]));
+    }
+    m_out << "};\n"
+          << "const bool symbolReserved[symbolCount] = {";
+    for (std::size_t i = 0; i < m_symbols.size(); ++i) {
+      m_out << (i ? ", " : "") << (SymbolTable::isReserved(m_symbols[i]) ? "true" : "false");
+    }
+    m_out << "};\n"
+          << "const int unnamed = 0;\n"
+          << runtimeEnvironment
+          << "inline Value program() {\n";
+    if (m_usesEnv) {
+      m_out << "  Environment env = Environment();\n";
+    }
+
+    // Declarations come before any label, so no jump crosses one.
+    // Temporaries that are never read, e.g. all arguments of begin but the
+    // last, get a (void) use to keep the generated code free of warnings.
+    for (const Temp & temp : m_declared) {
+      if (temp.type == Operand::Number) {
+        m_out << "  double " << temp.name << " = 0.0;\n";
+      } else if (temp.type == Operand::Boolean) {
+        m_out << "  bool " << temp.name << " = false;\n";
+      } else if (temp.type == Operand::Dynamic) {
+        m_out << "  Value " << temp.name << " = Value();\n";
+      }
+    }
+    for (const Temp & temp : m_declared) {
+      if (temp.type != Operand::Failed && !m_used.count(temp.name)) {
+        m_out << "  (void)" << temp.name << ";\n";
+      }
+    }
+
+    m_out << m_body
+          << "  return " << value << ";\n"
+          << "}\n"
+          << runtimeMain;
+  }
+
+private:
+  struct Temp {
+    std::string name;
+    Operand::Kind type; // Failed while not yet known, and for unused names
+  };
+
+  // An operator whose arguments are being generated
+  struct Frame {
+    const Node* node;
+    std::size_t next;           // index of the next child to generate
+    std::size_t count;          // children it generates
+    bool done;
+    Operand result;             // once done
+    std::vector<Operand> args;  // generated arguments of other operators
+    std::size_t temp;           // if, and, or: index of the result in m_declared
+    std::string elseLabel;      // if
+    std::string endLabel;       // if, and, or
+    Operand::Kind kinds[2];     // if: result kinds of the two branches
+    bool jumped;                // and, or: a clause jumps to endLabel
+  };
+
+  int symbolIndex(SymbolId id) {
+    auto found = m_index.find(id);
+    if (found != m_index.end()) {
+      return found->second;
+    }
+    int index = static_cast<int>(m_symbols.size());
+    m_symbols.push_back(id);
+    m_index[id] = index;
+    return index;
+  }
+
+  void line(const std::string & code) {
+    m_body += "  " + code + "\n";
+  }
+
+  // A new temporary; its C++ type follows from type
+  std::size_t reserve(Operand::Kind type) {
+    m_declared.push_back(Temp{"t" + std::to_string(m_temps++), type});
+    return m_declared.size() - 1;
+  }
+
+  std::string declare(Operand::Kind type, const std::string & init) {
+    const std::string & name = m_declared[reserve(type)].name;
+    line(name + " = " + init + ";");
+    return name;
+  }
+
+  std::string label() {
+    return "L" + std::to_string(m_labels++);
+  }
+
+  Operand fail(const std::string & message) {
+    line("fail(" + quote(message) + ");");
+    return Operand::of(Operand::Failed, "");
+  }
+
+  Operand dynamic(const std::string & init) {
+    return Operand::of(Operand::Dynamic, declare(Operand::Dynamic, init));
+  }
+
+  // Code of an operand that the generated program reads
+  const std::string & use(const Operand & operand) {
+    m_used.insert(operand.code);
+    return operand.code;
+  }
+
+  std::string valueOf(const Operand & operand) {
+    switch (operand.kind) {
+      case Operand::Number: return "number(" + use(operand) + ")";
+      case Operand::Boolean: return "boolean(" + use(operand) + ")";
+      case Operand::Symbol: return "symbol(" + std::to_string(operand.symbol) + ")";
+      default: return use(operand);
+    }
+  }
+
+  // numberArg of a Number, Symbol or Dynamic operand as an expression
+  std::string numberOf(const Operand & operand) {
+    switch (operand.kind) {
+      case Operand::Number:
+        return use(operand);
+      case Operand::Symbol:
+        m_usesEnv = true;
+        return "numberOf(env, " + std::to_string(operand.symbol) + ")";
+      default:
+        m_usesEnv = true;
+        return "numberArg(env, " + use(operand) + ")";
+    }
+  }
+
+  // boolArg of a Boolean, Symbol or Dynamic operand as an expression
+  std::string boolOf(const Operand & operand) {
+    switch (operand.kind) {
+      case Operand::Boolean:
+        return use(operand);
+      case Operand::Symbol:
+        m_usesEnv = true;
+        return "boolOf(env, " + std::to_string(operand.symbol) + ")";
+      default:
+        m_usesEnv = true;
+        return "boolArg(env, " + use(operand) + ")";
+    }
+  }
+
+  // Post-order walk on an explicit stack: each frame receives the operands
+  // of its children one by one in accept()
+  Operand generate(const Node* root) {
+    Operand result;
+    if (enter(root, result)) {
+      return result;
+    }
+    for (;;) {
+      if (!m_frames.back().done) {
+        Frame & top = m_frames.back();
+        const Node* child = top.node->children[top.next++];
+        if (enter(child, result)) {
+          accept(m_frames.back(), result);
+        }
+        continue;
+      }
+      result = m_frames.back().result;
+      m_frames.pop_back();
+      if (m_frames.empty()) {
+        return result;
+      }
+      accept(m_frames.back(), result);
+    }
+  }
+
+  // Start generating node. Leaves and lists that fail before any argument
+  // is generated give their operand at once and return true; other lists
+  // push a frame.
+  bool enter(const Node* node, Operand & result) {
+    if (node->children.empty()) {
+      if (node->data.isNumber()) {
+        result = Operand::of(Operand::Number, numberLiteral(node->data.asNumber()));
+      } else if (node->data.isBool()) {
+        result = Operand::of(Operand::Boolean, node->data.asBool() ? "true" : "false");
+      } else {
+        result = Operand::of(Operand::Symbol, "", symbolIndex(node->data.asSymbol()));
+      }
+      return true;
+    }
+    if (!node->data.isSymbol()) {
+      result = fail("Not a symbol");
+      return true;
+    }
+
+    Frame frame;
+    frame.node = node;
+    frame.next = 0;
+    frame.count = node->children.size();
+    frame.done = false;
+    frame.temp = 0;
+    frame.jumped = false;
+    if (node->op == Opcode::If) {
+      if (node->children.size() < 3) {
+        result = fail("Expected conditional");
+        return true;
+      }
+      frame.count = 3;
+    } else if (node->op == Opcode::And || node->op == Opcode::Or) {
+      if (node->children.size() < 2) {
+        result = fail("Expected bool");
+        return true;
+      }
+      // a bool that the clauses jump out with as soon as one decides it
+      frame.temp = reserve(Operand::Boolean);
+      line(m_declared[frame.temp].name + " = " + (node->op == Opcode::Or ? "true" : "false") + ";");
+      frame.endLabel = label();
+    }
+    m_frames.push_back(std::move(frame));
+    return false;
+  }
+
+  void finish(Frame & frame, const Operand & result) {
+    frame.done = true;
+    frame.result = result;
+  }
+
+  // Take the operand of the frame's child frame.next - 1
+  void accept(Frame & frame, const Operand & operand) {
+    switch (frame.node->op) {
+      case Opcode::If:
+        conditional(frame, operand);
+        break;
+      case Opcode::And:
+      case Opcode::Or:
+        shortCircuit(frame, operand);
+        break;
+      default:
+        // Children in order; once one always fails the rest is unreachable
+        frame.args.push_back(operand);
+        if (operand.kind == Operand::Failed) {
+          finish(frame, operand);
+        } else if (frame.next == frame.count) {
+          finish(frame, apply(frame.node, frame.args));
+        }
+        break;
+    }
+  }
+
+  Operand apply(const Node* node, const std::vector<Operand> & args) {
+    std::size_t argc = args.size();
+    switch (node->op) {
+      case Opcode::Add:
+      case Opcode::Multiply:
+      case Opcode::Subtract:
+      case Opcode::Divide:
+      case Opcode::Less:
+      case Opcode::LessEqual:
+      case Opcode::Greater:
+      case Opcode::GreaterEqual:
+      case Opcode::Equal:
+        return numeric(node->op, args);
+
+      case Opcode::Not:
+        return negation(args);
+
+      case Opcode::Define:
+        if (argc < 2) {
+          return fail("Expected conditional");
+        }
+        m_usesEnv = true;
+        return dynamic("define(env, " + valueOf(args[0]) + ", " + valueOf(args[1]) + ")");
+
+      case Opcode::Begin: {
+        const Operand & last = args.back();
+        if (last.kind == Operand::Symbol) {
+          m_usesEnv = true;
+          return dynamic("lookup(env, " + std::to_string(last.symbol) + ")");
+        }
+        if (last.kind == Operand::Dynamic) {
+          m_usesEnv = true;
+          return dynamic("begin(env, " + use(last) + ")");
+        }
+        return last;
+      }
+
+      default:
+        return fail("Unknown operator: " + symbolName(node->data.asSymbol()));
+    }
+  }
+
+  // Code storing a branch result in the if's result temporary
+  void assign(const Frame & frame, const Operand & result) {
+    if (result.kind == Operand::Failed) {
+      return;
+    }
+    std::string code = result.kind == Operand::Symbol ? valueOf(result) : use(result);
+    line("set(" + m_declared[frame.temp].name + ", " + code + ");");
+  }
+
+  // if as a special form: the condition jumps over the first branch to the
+  // second, and only the selected branch assigns the result
+  void conditional(Frame & frame, const Operand & operand) {
+    if (frame.next == 1) {
+      std::string test;
+      if (operand.kind == Operand::Failed) {
+        finish(frame, operand);
+        return;
+      } else if (operand.kind == Operand::Boolean) {
+        test = use(operand);
+      } else if (operand.kind == Operand::Dynamic) {
+        test = "condition(" + use(operand) + ")";
+      } else {
+        finish(frame, fail("Not a boolean"));
+        return;
+      }
+      frame.temp = reserve(Operand::Failed);
+      frame.elseLabel = label();
+      frame.endLabel = label();
+      line("if (!" + test + ") goto " + frame.elseLabel + ";");
+      return;
+    }
+
+    frame.kinds[frame.next - 2] = operand.kind;
+    assign(frame, operand);
+    if (frame.next == 2) {
+      line("goto " + frame.endLabel + ";");
+      m_body += frame.elseLabel + ":;\n";
+      return;
+    }
+    m_body += frame.endLabel + ":;\n";
+
+    Operand::Kind first = frame.kinds[0];
+    Operand::Kind second = frame.kinds[1];
+    Operand::Kind kind = Operand::Dynamic;
+    if ((first == Operand::Number || first == Operand::Boolean) &&
+        (second == first || second == Operand::Failed)) {
+      kind = first;
+    } else if (first == Operand::Failed &&
+               (second == Operand::Number || second == Operand::Boolean)) {
+      kind = second;
+    } else if (first == Operand::Failed && second == Operand::Failed) {
+      kind = Operand::Failed;
+    }
+    m_declared[frame.temp].type = kind;
+    finish(frame, Operand::of(kind, kind == Operand::Failed ? "" : m_declared[frame.temp].name));
+  }
+
+  // + - * / and the comparisons, with the arity checks of applyOp
+  Operand numeric(Opcode op, const std::vector<Operand> & args) {
+    std::size_t argc = args.size();
+    bool nary = op == Opcode::Add || op == Opcode::Multiply;
+    if ((nary && argc < 2) || (op == Opcode::Subtract && argc > 2) ||
+        (!nary && op != Opcode::Subtract && argc != 2)) {
+      return fail("Expected number");
+    }
+
+    for (const Operand & arg : args) {
+      if (arg.kind != Operand::Number && arg.kind != Operand::Symbol && arg.kind != Operand::Dynamic) {
+        return fail("Expected number");
+      }
+    }
+    std::vector<std::string> nums;
+    for (const Operand & arg : args) {
+      nums.push_back(numberOf(arg));
+    }
+
+    if (nary) {
+      // Accumulate from 0 or 1, left to right, as applyOp does
+      bool add = op == Opcode::Add;
+      std::string name = declare(Operand::Number, add ? "0.0" : "1.0");
+      for (const std::string & num : nums) {
+        line(name + " = " + name + (add ? " + " : " * ") + num + ";");
+      }
+      return Operand::of(Operand::Number, name);
+    }
+    if (argc == 1) {
+      return Operand::of(Operand::Number, declare(Operand::Number, "-(" + nums[0] + ")"));
+    }
+
+    const char* symbol = "";
+    switch (op) {
+      case Opcode::Subtract: symbol = " - "; break;
+      case Opcode::Divide: symbol = " / "; break;
+      case Opcode::Less: symbol = " < "; break;
+      case Opcode::LessEqual: symbol = " <= "; break;
+      case Opcode::Greater: symbol = " > "; break;
+      case Opcode::GreaterEqual: symbol = " >= "; break;
+      default: symbol = " == "; break;
+    }
+    bool comparison = op != Opcode::Subtract && op != Opcode::Divide;
+    Operand::Kind kind = comparison ? Operand::Boolean : Operand::Number;
+    return Operand::of(kind, declare(kind, nums[0] + symbol + nums[1]));
+  }
+
+  // and / or as special forms: each clause but the last jumps to the end
+  // as soon as it decides the result
+  void shortCircuit(Frame & frame, const Operand & clause) {
+    const std::string & name = m_declared[frame.temp].name;
+    bool last = frame.next == frame.count;
+    bool stop = true;
+    if (clause.kind == Operand::Failed) {
+      // the rest is unreachable
+    } else if (clause.kind != Operand::Boolean && clause.kind != Operand::Symbol &&
+               clause.kind != Operand::Dynamic) {
+      fail("Expected bool");
+    } else if (last) {
+      line(name + " = " + boolOf(clause) + ";");
+    } else {
+      bool decisive = frame.node->op == Opcode::Or;
+      line(std::string("if (") + (decisive ? "" : "!") + boolOf(clause) + ") goto " +
+           frame.endLabel + ";");
+      frame.jumped = true;
+      stop = false;
+    }
+
+    if (stop) {
+      if (frame.jumped) {
+        m_body += frame.endLabel + ":;\n";
+      }
+      finish(frame, Operand::of(Operand::Boolean, name));
+    }
+  }
+
+  // not, with the arity check of applyOp
+  Operand negation(const std::vector<Operand> & args) {
+    if (args.size() != 1) {
+      return fail("Expected bool");
+    }
+
+    const Operand & arg = args[0];
+    if (arg.kind != Operand::Boolean && arg.kind != Operand::Symbol && arg.kind != Operand::Dynamic) {
+      return fail("Expected bool");
+    }
+    return Operand::of(Operand::Boolean, declare(Operand::Boolean, "!" + boolOf(args[0])));
+  }
+
+  std::ostream & m_out;
+  std::string m_body;
+  std::vector<SymbolId> m_symbols;
+  std::unordered_map<SymbolId, int> m_index;
+  std::vector<Temp> m_declared;
+  std::vector<Frame> m_frames;
+  std::unordered_set<std::string> m_used;
+  unsigned m_temps;
+  unsigned m_labels;
+  bool m_usesEnv;
+};
+
+}
+
+void Interpreter::transpile(std::ostream & out) const {
+  if (!ASTroot) {
+    throw InterpreterSemanticError("Transpile error: no program parsed");
+  }
+  CppWriter(out).program(ASTroot);
+}
@@ -1,14 +1,43 @@
 #define CATCH_CONFIG_MAIN
 #include "catch.hpp"
 
+#include <atomic>
+#include <cstdlib>
+#include <new>
 #include <string>
 #include <sstream>
 #include <fstream>
 #include <iostream>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
 
 #include "interpreter_semantic_error.hpp"
+#include "arena.hpp"
 #include "interpreter.hpp"
+#include "program.hpp"
+#include "environment.hpp"
+#include "shared_environment.hpp"
+#include "symbol_map.hpp"
 #include "expression.hpp"
+#include "value.hpp"
+
+// Heap allocations made by this test program so far
+static std::atomic<std::size_t> allocations(0);
+
+void* operator new(std::size_t size) {
+  ++allocations;
+  void* memory = std::malloc(size != 0 ? size : 1);
+  if (!memory) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void operator delete(void* memory) noexcept {
+  std::free(memory);
+}
 
 Expression run(const std::string & program){
   
@@ -175,6 +204,29 @@ TEST_CASE( "Test Interpreter parser with incorrect input. Regression Test", "[in
   REQUIRE(ok == false); 
 }
 
+TEST_CASE( "Test Interpreter parser reused for several programs", "[interpreter]" ) {
+
+  Interpreter interp;
+
+  {
+    std::istringstream iss("(+ 1 (* 2 3))");
+    REQUIRE(interp.parse(iss) == true);
+    REQUIRE(interp.eval() == Expression(7.));
+  }
+
+  { // a failed parse leaves no program behind
+    std::istringstream iss("(+ 1 (* 2 3)");
+    REQUIRE(interp.parse(iss) == false);
+    REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+  }
+
+  {
+    std::istringstream iss("(- (+ 10 1) (- 30 (- 1 1)))");
+    REQUIRE(interp.parse(iss) == true);
+    REQUIRE(interp.eval() == Expression(-19.));
+  }
+}
+
 TEST_CASE( "Test Interpreter result with literal expressions", "[interpreter]" ) {
 
   { // Boolean True
@@ -285,6 +337,111 @@ TEST_CASE( "Test Interpreter special forms: begin and define", "[interpreter]" )
   }
 }
 
+TEST_CASE( "Test define copies the value of another symbol", "[interpreter]" ) {
+
+  {
+    std::string program = "(begin (define x 2) (define y x) (y))";
+    Expression result = run(program);
+    REQUIRE(result == Expression(2.));
+  }
+
+  {
+    std::string program = "(begin (define b True) (define c b) (not c))";
+    Expression result = run(program);
+    REQUIRE(result == Expression(false));
+  }
+
+  { // a symbol bound to a boolean is not a number
+    std::string program = "(begin (define b True) (+ b 1))";
+    Expression failed = failed_run(program);
+    REQUIRE(failed == true);
+  }
+}
+
+TEST_CASE( "Test Expression stores only the active payload", "[expression]" ) {
+
+  REQUIRE(sizeof(Expression) <= 16);
+
+  Expression symbol(std::string("answer"));
+  Expression copy = symbol;
+  REQUIRE(copy == symbol);
+  REQUIRE(copy.getSymbol() == "answer");
+
+  copy = Expression(4.);
+  REQUIRE(copy.isNumber());
+  REQUIRE(symbol.getSymbol() == "answer");
+
+  Expression moved = std::move(symbol);
+  REQUIRE(moved.getSymbol() == "answer");
+
+  Expression list;
+  list.addArgument(Expression(1.));
+  list.addArgument(moved);
+  Expression listCopy = list;
+  REQUIRE(listCopy.getArgs().size() == 2);
+  REQUIRE(listCopy.getArgs()[1] == moved);
+}
+
+TEST_CASE( "Test symbols are interned to stable ids", "[symbols]" ) {
+
+  SymbolId answer = intern("answer");
+  REQUIRE(intern("answer") == answer);
+  REQUIRE(symbolName(answer) == "answer");
+  REQUIRE(intern("answer2") != answer);
+
+  REQUIRE(intern("+") == Sym::Add);
+  REQUIRE(intern("if") == Sym::If);
+  REQUIRE(SymbolTable::isReserved(Sym::Define));
+  REQUIRE_FALSE(SymbolTable::isReserved(answer));
+
+  Expression symbol(std::string("answer"));
+  REQUIRE(symbol.getSymbolId() == answer);
+  REQUIRE(Expression::fromSymbol(answer) == symbol);
+  REQUIRE(symbol.getSymbol() == "answer");
+}
+
+TEST_CASE( "Test NaN-boxed Value encoding", "[value]" ) {
+
+  REQUIRE(sizeof(Value) == 8);
+
+  std::vector<double> numbers = {0., -0., 1.5, -3., 1e308, -1e-308,
+                                 std::numeric_limits<double>::infinity(),
+                                 -std::numeric_limits<double>::infinity()};
+  for (double number : numbers) {
+    Value value = Value::number(number);
+    REQUIRE(value.isNumber());
+    REQUIRE_FALSE(value.isBool());
+    REQUIRE_FALSE(value.isSymbol());
+    REQUIRE(std::signbit(value.asNumber()) == std::signbit(number));
+    REQUIRE(value.asNumber() == number);
+  }
+
+  { // NaNs stay numbers, including ones whose bits overlap the boxed tags
+    double nan = std::nan("");
+    REQUIRE(Value::number(nan).isNumber());
+    REQUIRE(std::isnan(Value::number(-nan).asNumber()));
+
+    std::uint64_t bits = 0xFFFA000000000001ull;
+    double boxedLooking;
+    std::memcpy(&boxedLooking, &bits, sizeof(boxedLooking));
+    REQUIRE(Value::number(boxedLooking).isNumber());
+    REQUIRE(std::isnan(Value::number(boxedLooking).asNumber()));
+  }
+
+  REQUIRE(Value::boolean(true).isBool());
+  REQUIRE(Value::boolean(true).asBool() == true);
+  REQUIRE(Value::boolean(false).asBool() == false);
+  REQUIRE_FALSE(Value::boolean(false).isNumber());
+
+  REQUIRE(Value::symbol(42).isSymbol());
+  REQUIRE(Value::symbol(42).asSymbol() == 42);
+  REQUIRE(Value::symbol(0xFFFFFFFFu).asSymbol() == 0xFFFFFFFFu);
+
+  REQUIRE(Value::list(7).isList());
+  REQUIRE(Value::list(7).asList() == 7);
+  REQUIRE(Value().isNone());
+}
+
 TEST_CASE( "Test a complex expression", "[interpreter]" ) {
 
   {
@@ -607,3 +764,913 @@ TEST_CASE( "Extra", "[interpreter]" ) {
     REQUIRE(result == Expression(false));
   }
 }
+
+// Programs whose results (or errors) must agree across evaluation backends
+static const std::vector<std::string> backend_programs = {
+  "(True)", "(False)", "(4)", "(pi)", "(hello)",
+  "(+ 1 2)", "(+ 1 (+ 2 3))", "(+ 1 2 3 4 5 6)", "(+ 1)",
+  "(- 1 2)", "(- 1)", "(- 1 2 9)", "(- (+ 10 1) (- 30 (- 1 1)))",
+  "(* 1 2 3 4 5 6)", "(* 1)", "(/ 1 2)", "(/ 1)", "(/ 1 0)",
+  "(< 1 2)", "(<= 1 1)", "(> 1 2)", "(>= 2 3)", "(= 4 4)", "(= 1)",
+  "(not True)", "(not True False)", "(and True True False)", "(or False True)", "(and True)",
+  "(if True (4) (-4))", "(if False (4) (-4))", "(if False (-4))",
+  "(if (< 1 2) (+ 1 1) (- 1 1))",
+  "(define answer 42)", "(define if 1)", "(define 3 4)",
+  "(begin (define answer (+ 9 11)) (answer))",
+  "(begin (define a 1) (define b pi) (if (< a b) b a))",
+  "(begin (define x 3) (define x 4))",
+  "(begin (define x True) (not x))",
+  "(begin (define r 10) (* pi (* r r)))",
+  "(begin (define a 4) (define b 1) (/ a b))",
+  "(+ a 2)", "(@ none)", "(1 2)",
+  "(if True 1 (@ none))", "(if False (/ 1 True) (+ 1 1))", "(if 1 2 3)", "(if (@ none) 1 2)",
+  "(if (< 1 2) (if (> 1 2) 10 20) 30)", "(if True (if False (if True 1 2) (+ 3 4)) 5)",
+  "(begin (define x 1) (if False (define x 2) (+ x 1)))",
+  "(begin (if True (define a 1) (define b 2)) (+ a 1))",
+  "(begin (if True (define a 1) (define b 2)) (+ b 1))",
+  "(begin (define t True) (if t 1 2))",
+  "(and False (@ none))", "(or True (@ none))", "(and True (@ none))", "(or False 1)",
+  "(and True True 1)", "(and False 1)", "(or False False (< 1 2))", "(and (< 1 2) (> 1 2) (foo))",
+  "(begin (define b False) (or b (define c True)) (and c True))",
+  "(begin (define b True) (or b (define c True)) (and c True))",
+  "(+ y (define y 2))", "(begin (define x True) (+ x 1))", "(begin (define n 1) (and n True))",
+  "(begin (define x 2) (define y x) (* x y))", "(begin (define t False) (not t))"
+};
+
+static bool same_result(const std::string & program, Interpreter::Backend backend, bool optimize = false){
+
+  Expression expected, actual;
+  bool expected_throws = false, actual_throws = false;
+
+  {
+    std::istringstream iss(program);
+    Interpreter interp;
+    REQUIRE(interp.parse(iss) == true);
+    try { expected = interp.eval(); } catch (const InterpreterSemanticError &) { expected_throws = true; }
+  }
+
+  {
+    std::istringstream iss(program);
+    Interpreter interp;
+    interp.setBackend(backend);
+    REQUIRE(interp.parse(iss) == true);
+    if (optimize) {
+      interp.optimize();
+    }
+    try { actual = interp.eval(); } catch (const InterpreterSemanticError &) { actual_throws = true; }
+  }
+
+  if (expected_throws || actual_throws) {
+    return expected_throws == actual_throws;
+  }
+  return expected == actual;
+}
+
+TEST_CASE( "Test FlatAST backend agrees with the tree walker", "[interpreter]" ) {
+
+  for (auto program : backend_programs) {
+    INFO(program);
+    REQUIRE(same_result(program, Interpreter::Backend::FlatAST));
+  }
+
+  { // evaluating twice reuses the flattened program
+    std::istringstream iss("(+ (* 2 3) (- 10 4) 1)");
+    Interpreter interp;
+    interp.setBackend(Interpreter::Backend::FlatAST);
+    REQUIRE(interp.parse(iss) == true);
+    REQUIRE(interp.eval() == Expression(13.));
+    REQUIRE(interp.eval() == Expression(13.));
+  }
+}
+
+TEST_CASE( "Test Bytecode backend agrees with the tree walker", "[interpreter]" ) {
+
+  for (auto program : backend_programs) {
+    INFO(program);
+    REQUIRE(same_result(program, Interpreter::Backend::Bytecode));
+  }
+
+  { // evaluating twice reuses the compiled program
+    std::istringstream iss("(+ (* 2 3) (- 10 4) (- 1))");
+    Interpreter interp;
+    interp.setBackend(Interpreter::Backend::Bytecode);
+    REQUIRE(interp.parse(iss) == true);
+    REQUIRE(interp.eval() == Expression(11.));
+    REQUIRE(interp.eval() == Expression(11.));
+  }
+
+  { // reparsing drops the old code
+    Interpreter interp;
+    interp.setBackend(Interpreter::Backend::Bytecode);
+    std::istringstream first("(+ 1 2)");
+    REQUIRE(interp.parse(first) == true);
+    REQUIRE(interp.eval() == Expression(3.));
+    std::istringstream second("(< 1 2)");
+    REQUIRE(interp.parse(second) == true);
+    REQUIRE(interp.eval() == Expression(true));
+  }
+}
+
+TEST_CASE( "Test Jit backend agrees with the tree walker", "[interpreter]" ) {
+
+  for (auto program : backend_programs) {
+    INFO(program);
+    REQUIRE(same_result(program, Interpreter::Backend::Jit));
+  }
+
+  const std::vector<std::string> formulas = {
+    "(+ x y)", "(- x)", "(- (- x))", "(- x y)", "(* x y z)", "(/ x z)", "(/ x 0)",
+    "(+ (* 3 x x) (* -2 x) 7)", "(/ (- (* x y) z) (+ x (* y z) 1))",
+    "(+ (- 0) 0)", "(- (* 0 y))", "(/ (- x x) 0)",
+    "(< x y)", "(<= x x)", "(> (* x 2) (+ y 1))", "(>= z y)", "(= (+ x x) (* x 2))",
+    "(> (/ 0 0) 1)", "(< (/ 0 0) 1)", "(= (/ 0 0) (/ 0 0))"
+  };
+
+  Interpreter interp;
+  interp.setBackend(Interpreter::Backend::Jit);
+  interp.setJitVerify(true);
+  std::istringstream preamble("(begin (define x 1.5) (define y -2) (define z 0.25) (define t True) z)");
+  REQUIRE(interp.parse(preamble) == true);
+  REQUIRE(interp.eval() == Expression(0.25));
+
+  for (auto formula : formulas) {
+    INFO(formula);
+    std::istringstream iss(formula);
+    REQUIRE(interp.parse(iss) == true);
+    REQUIRE_NOTHROW(interp.eval());
+    REQUIRE(interp.jitCompiled() == JitProgram::supported());
+  }
+
+  { // same answers as the tree walker
+    std::istringstream iss("(+ (* 3 x x) (* -2 x) 7)");
+    REQUIRE(interp.parse(iss) == true);
+    REQUIRE(interp.eval() == Expression(3 * 1.5 * 1.5 - 2 * 1.5 + 7));
+    std::istringstream cmp("(> x y)");
+    REQUIRE(interp.parse(cmp) == true);
+    REQUIRE(interp.eval() == Expression(true));
+  }
+
+  { // symbols that are unbound or not numbers fall back and raise the usual error
+    std::istringstream unbound("(+ x w)");
+    REQUIRE(interp.parse(unbound) == true);
+    REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+    std::istringstream boolean("(* x t)");
+    REQUIRE(interp.parse(boolean) == true);
+    REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+  }
+
+  { // programs outside the numeric subset are not compiled
+    std::istringstream iss("(if (< x y) 1 2)");
+    REQUIRE(interp.parse(iss) == true);
+    REQUIRE(interp.eval() == Expression(2.));
+    REQUIRE(interp.jitCompiled() == false);
+  }
+}
+
+TEST_CASE( "Test transpiling programs to C++", "[interpreter]" ) {
+
+  { // numeric code becomes inline arithmetic on doubles
+    std::istringstream iss("(+ 1 (* 2 3))");
+    Interpreter interp;
+    REQUIRE(interp.parse(iss) == true);
+    std::ostringstream out;
+    interp.transpile(out);
+    std::string code = out.str();
+    REQUIRE(code.find("double t0 = 0.0;") != std::string::npos);
+    REQUIRE(code.find("  t0 = 1.0;") != std::string::npos);
+    REQUIRE(code.find("t0 = t0 * 2.0;") != std::string::npos);
+    REQUIRE(code.find("int main()") != std::string::npos);
+    REQUIRE(code.find("Environment env") == std::string::npos);
+  }
+
+  { // symbols live in a local environment
+    std::istringstream iss("(begin (define a 1) (define b pi) (if (< a b) b a))");
+    Interpreter interp;
+    REQUIRE(interp.parse(iss) == true);
+    std::ostringstream out;
+    interp.transpile(out);
+    std::string code = out.str();
+    REQUIRE(code.find("Environment env = Environment();") != std::string::npos);
+    REQUIRE(code.find("numberOf(env, 1) < numberOf(env, 2)") != std::string::npos);
+    REQUIRE(code.find("3.1415926535897931") != std::string::npos);
+  }
+
+  { // errors known up front are raised where eval would raise them
+    std::istringstream iss("(+ 1 (not 2))");
+    Interpreter interp;
+    REQUIRE(interp.parse(iss) == true);
+    std::ostringstream out;
+    interp.transpile(out);
+    REQUIRE(out.str().find("fail(\"Expected bool\");") != std::string::npos);
+  }
+
+  { // if, and and or jump to labels, so the code stays flat however deep
+    std::string program;
+    for (int i = 0; i < 1000; ++i) {
+      program += "(if True (or False ";
+    }
+    program += "1";
+    for (int i = 0; i < 1000; ++i) {
+      program += ") 2)";
+    }
+    std::istringstream iss(program);
+    Interpreter interp;
+    REQUIRE(interp.parse(iss) == true);
+    std::ostringstream out;
+    interp.transpile(out);
+    std::string code = out.str();
+    REQUIRE(code.find("if (!true) goto L0;") != std::string::npos);
+    REQUIRE(code.size() < 400 * 1000);
+  }
+
+  { // nothing to transpile
+    Interpreter interp;
+    std::ostringstream out;
+    REQUIRE_THROWS_AS(interp.transpile(out), InterpreterSemanticError);
+  }
+}
+
+TEST_CASE( "Test Tiered backend promotes hot programs", "[interpreter]" ) {
+
+  for (auto program : backend_programs) {
+    INFO(program);
+    REQUIRE(same_result(program, Interpreter::Backend::Tiered));
+  }
+
+  { // cold at first, bytecode once the background compile lands
+    std::istringstream iss("(+ (* 2 3) (- 10 4) (- 1))");
+    Interpreter interp;
+    interp.setBackend(Interpreter::Backend::Tiered);
+    interp.setTierThreshold(3);
+    REQUIRE(interp.parse(iss) == true);
+
+    for (int i = 0; i < 3; ++i) {
+      REQUIRE(interp.promoted() == false);
+      REQUIRE(interp.eval() == Expression(11.));
+    }
+    REQUIRE(interp.evalCount() == 3);
+
+    for (int i = 0; i < 10000 && !interp.promoted(); ++i) {
+      std::this_thread::yield();
+      REQUIRE(interp.eval() == Expression(11.));
+    }
+    REQUIRE(interp.promoted() == true);
+    REQUIRE(interp.eval() == Expression(11.));
+  }
+
+  { // parsing a new program resets the counter and drops the old tier
+    Interpreter interp;
+    interp.setBackend(Interpreter::Backend::Tiered);
+    interp.setTierThreshold(0);
+    std::istringstream first("(< 1 2)");
+    REQUIRE(interp.parse(first) == true);
+    REQUIRE(interp.eval() == Expression(true));
+    std::istringstream second("(+ 1 2)");
+    REQUIRE(interp.parse(second) == true);
+    REQUIRE(interp.evalCount() == 0);
+    REQUIRE(interp.promoted() == false);
+    REQUIRE(interp.eval() == Expression(3.));
+  }
+
+  { // a program still compiling when the interpreter goes away
+    Interpreter interp;
+    interp.setBackend(Interpreter::Backend::Tiered);
+    interp.setTierThreshold(1);
+    std::istringstream iss("(begin (define x 2) (* x x))");
+    REQUIRE(interp.parse(iss) == true);
+    REQUIRE(interp.eval() == Expression(4.));
+  }
+}
+
+TEST_CASE( "Test if evaluates only the selected branch", "[interpreter]" ) {
+
+  { // the untaken branch would raise an error
+    std::string program = "(if (< 1 2) (+ 1 2) (foo 1))";
+    INFO(program);
+    REQUIRE(run(program) == Expression(3.));
+  }
+
+  { // nested ifs
+    std::string program = "(if (> 1 2) (foo) (if (< 1 2) (if False (bar) 7) (baz)))";
+    INFO(program);
+    REQUIRE(run(program) == Expression(7.));
+  }
+
+  { // a define in the taken branch binds, one in the untaken branch does not
+    std::string program = "(begin (if True (define a 1) (define b 2)) (define b 3) (+ a b))";
+    INFO(program);
+    REQUIRE(run(program) == Expression(4.));
+  }
+
+  { // redefining in the untaken branch is not an error
+    std::string program = "(begin (define x 1) (if (= x 1) (+ x 1) (define x 2)))";
+    INFO(program);
+    REQUIRE(run(program) == Expression(2.));
+  }
+
+  { // the condition is still checked
+    std::istringstream iss("(if (+ 1 2) 1 2)");
+    Interpreter interp;
+    REQUIRE(interp.parse(iss) == true);
+    REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+  }
+}
+
+TEST_CASE( "Test and / or stop at the deciding clause", "[interpreter]" ) {
+
+  { // clauses after the deciding one are not evaluated
+    REQUIRE(run("(and (< 2 1) (foo))") == Expression(false));
+    REQUIRE(run("(or (< 1 2) (foo))") == Expression(true));
+    REQUIRE(run("(and True (or False (= 1 1) (bar)) (not False))") == Expression(true));
+  }
+
+  { // including their defines
+    REQUIRE(run("(begin (and False (define x 1)) (define x 2))") == Expression(2.));
+    REQUIRE(run("(begin (or False (define x True)) (and x True))") == Expression(true));
+  }
+
+  { // clauses up to the deciding one are still checked
+    std::istringstream iss("(and True 1 False)");
+    Interpreter interp;
+    REQUIRE(interp.parse(iss) == true);
+    REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+  }
+}
+
+TEST_CASE( "Test optimize folds constants and identities", "[interpreter]" ) {
+
+  auto optimized = [](const std::string & program, std::size_t removed) {
+    std::istringstream iss(program);
+    Interpreter interp;
+    REQUIRE(interp.parse(iss) == true);
+    REQUIRE(interp.optimize() == removed);
+    return interp.eval();
+  };
+
+  { // constant subtrees, pi included, become literals
+    REQUIRE(optimized("(* 2 (/ pi 4))", 4) == Expression(2 * (std::atan2(0, -1) / 4)));
+    REQUIRE(optimized("(if (< 1 2) 3 (foo))", 5) == Expression(3.));
+    REQUIRE(optimized("(and (< 2 1) (foo))", 2) == Expression(false));
+  }
+
+  { // identity operands are dropped
+    REQUIRE(optimized("(begin (define x 3) (+ (* x 1) 0 1))", 3) == Expression(4.));
+    REQUIRE(optimized("(begin (define x 3) (- (/ (* 1 (+ x 1) 1) 1) 0))", 7) == Expression(4.));
+  }
+
+  { // but not where that would change the result or the error
+    REQUIRE(optimized("(begin (define x -0) (/ 1 (+ x 0)))", 0) ==
+            Expression(std::numeric_limits<double>::infinity()));
+    REQUIRE(optimized("(begin (define x 3) (* x 1))", 0) == Expression(3.));
+
+    std::istringstream iss("(begin (define x True) (+ (* x 1) (define y 2)))");
+    Interpreter interp;
+    REQUIRE(interp.parse(iss) == true);
+    REQUIRE(interp.optimize() == 0);
+    REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+  }
+
+  std::vector<Interpreter::Backend> backends = {
+    Interpreter::Backend::TreeWalker, Interpreter::Backend::FlatAST, Interpreter::Backend::Bytecode,
+    Interpreter::Backend::Jit, Interpreter::Backend::Tiered
+  };
+  for (auto program : backend_programs) {
+    INFO(program);
+    for (auto backend : backends) {
+      REQUIRE(same_result(program, backend, true));
+    }
+  }
+}
+
+TEST_CASE( "Test programs nested a million levels deep", "[interpreter]" ) {
+
+  const std::size_t depth = 1000000;
+  auto nested = [depth](const std::string & open, const std::string & leaf, const std::string & close) {
+    std::string program;
+    program.reserve(depth * (open.size() + close.size()) + leaf.size());
+    for (std::size_t i = 0; i < depth; ++i) {
+      program += open;
+    }
+    program += leaf;
+    for (std::size_t i = 0; i < depth; ++i) {
+      program += close;
+    }
+    return program;
+  };
+
+  { // parse and evaluate without exhausting the native stack
+    REQUIRE(run(nested("(+ 1 ", "1", ")")) == Expression(depth + 1.));
+    REQUIRE(run(nested("(if True (and True ", "False", ") 0)")) == Expression(false));
+  }
+
+  std::string program = nested("(* 1 ", "(+ 2 3)", ")");
+
+  { // the flat walker is iterative too; the compiling backends hand such
+    // programs to the tree walker
+    std::vector<Interpreter::Backend> backends = {
+      Interpreter::Backend::FlatAST, Interpreter::Backend::Bytecode
+    };
+    for (auto backend : backends) {
+      std::istringstream iss(program);
+      Interpreter interp;
+      interp.setBackend(backend);
+      REQUIRE(interp.parse(iss) == true);
+      REQUIRE(interp.eval() == Expression(5.));
+    }
+  }
+
+  { // transpile walks the tree iteratively too, and optimize folds it
+    std::istringstream iss(program);
+    Interpreter interp;
+    REQUIRE(interp.parse(iss) == true);
+    std::ostringstream out;
+    interp.transpile(out);
+    REQUIRE(out.str().find("return number(t") != std::string::npos);
+    REQUIRE(interp.optimize() == 2 * depth + 2);
+    REQUIRE(interp.eval() == Expression(5.));
+  }
+}
+
+TEST_CASE( "Test programs nested as deep as the compilers take", "[interpreter]" ) {
+
+  // depth levels cycling through the given lists around leaf
+  const std::size_t depth = Interpreter::MaxCompileDepth;
+  auto nested = [depth](const std::vector<std::string> & open, const std::vector<std::string> & close,
+                        const std::string & leaf) {
+    std::string program;
+    for (std::size_t i = 0; i < depth; ++i) {
+      program += open[i % open.size()];
+    }
+    program += leaf;
+    for (std::size_t i = depth; i-- > 0;) {
+      program += close[i % close.size()];
+    }
+    return program;
+  };
+  std::string conditions = nested({"(if True ", "(and True ", "(or False "}, {" 0)", ")", ")"}, "True");
+  std::string arithmetic = nested({"(+ 0 ", "(- ", "(* 1 "}, {")", " 0)", ")"}, "2");
+
+  { // the compiling backends run them rather than the tree walker
+    std::vector<Interpreter::Backend> backends = {
+      Interpreter::Backend::Bytecode, Interpreter::Backend::Jit, Interpreter::Backend::Tiered
+    };
+    for (auto backend : backends) {
+      std::istringstream iss(conditions);
+      Interpreter interp;
+      interp.setBackend(backend);
+      interp.setTierThreshold(1);
+      REQUIRE(interp.parse(iss) == true);
+      REQUIRE(interp.program()->depth() == depth);
+      REQUIRE(interp.eval() == Expression(true));
+      REQUIRE(interp.eval() == Expression(true));
+    }
+
+    std::istringstream iss(arithmetic);
+    Interpreter interp;
+    interp.setBackend(Interpreter::Backend::Jit);
+    REQUIRE(interp.parse(iss) == true);
+    REQUIRE(interp.program()->depth() == depth);
+    REQUIRE(interp.eval() == Expression(2.));
+    REQUIRE(interp.jitCompiled() == JitProgram::supported());
+  }
+
+  { // and transpile them
+    for (const std::string & program : {conditions, arithmetic}) {
+      std::istringstream iss(program);
+      Interpreter interp;
+      REQUIRE(interp.parse(iss) == true);
+      std::ostringstream out;
+      interp.transpile(out);
+      REQUIRE(out.str().find("int main()") != std::string::npos);
+    }
+  }
+}
+
+TEST_CASE( "Test evaluating numeric programs allocates nothing", "[interpreter]" ) {
+
+  std::vector<Interpreter::Backend> backends = {
+    Interpreter::Backend::TreeWalker, Interpreter::Backend::FlatAST,
+    Interpreter::Backend::Bytecode, Interpreter::Backend::Jit
+  };
+  for (auto backend : backends) {
+    Interpreter interp;
+    interp.setBackend(backend);
+    std::istringstream definition("(define x 5)");
+    REQUIRE(interp.parse(definition) == true);
+    interp.eval();
+
+    std::istringstream iss("(+ (* x 3 pi) (- 10 (/ 8 x)) (- 1) (* (+ x 1) (- x 2) 0.5))");
+    REQUIRE(interp.parse(iss) == true);
+    Expression expected = interp.eval(); // builds any backend-specific form
+
+    std::size_t before = allocations;
+    bool same = true;
+    for (int i = 0; i < 100; ++i) {
+      same = same && interp.eval() == expected;
+    }
+    std::size_t allocated = allocations - before;
+    REQUIRE(same);
+    REQUIRE(allocated == 0);
+  }
+}
+
+TEST_CASE( "Test Environment lookup does not throw", "[environment]" ) {
+
+  Environment env;
+  env.define("answer", Expression(42.));
+
+  REQUIRE(env.lookup(intern("answer")) != nullptr);
+  REQUIRE(*env.lookup(intern("answer")) == Expression(42.));
+  REQUIRE(env.lookup(intern("question")) == nullptr);
+
+  REQUIRE(env.get("answer") == Expression(42.));
+  REQUIRE_THROWS_AS(env.get("question"), InterpreterSemanticError);
+}
+
+TEST_CASE( "Test SymbolMap binds many symbols", "[environment]" ) {
+
+  SymbolMap map;
+  REQUIRE(map.find(intern("a")) == nullptr);
+
+  // enough bindings to rehash several times
+  std::vector<SymbolId> ids;
+  for (int i = 0; i < 5000; ++i) {
+    ids.push_back(intern("map_key_" + std::to_string(i)));
+    map.assign(ids.back(), Expression(double(i)));
+  }
+  REQUIRE(map.size() == ids.size());
+
+  bool all = true;
+  for (std::size_t i = 0; i < ids.size(); ++i) {
+    const Expression* value = map.find(ids[i]);
+    all = all && value && *value == Expression(double(i));
+  }
+  REQUIRE(all);
+  REQUIRE(map.find(intern("map_key_unbound")) == nullptr);
+
+  { // assigning again replaces the value
+    map.assign(ids[7], Expression(true));
+    REQUIRE(map.size() == ids.size());
+    REQUIRE(*map.find(ids[7]) == Expression(true));
+  }
+
+  { // forEach visits every binding once
+    std::size_t visited = 0;
+    map.forEach([&visited](SymbolId, const Expression &) { ++visited; });
+    REQUIRE(visited == ids.size());
+  }
+
+  { // copies are independent
+    SymbolMap copy = map;
+    copy.assign(ids[0], Expression(-1.));
+    REQUIRE(*map.find(ids[0]) == Expression(0.));
+    map.clear();
+    REQUIRE(map.find(ids[0]) == nullptr);
+    REQUIRE(*copy.find(ids[0]) == Expression(-1.));
+  }
+}
+
+TEST_CASE( "Test symbols read by operators are resolved to slots", "[interpreter]" ) {
+
+  std::vector<Interpreter::Backend> backends = {
+    Interpreter::Backend::TreeWalker, Interpreter::Backend::Bytecode
+  };
+  for (auto backend : backends) {
+    Interpreter interp;
+    interp.setBackend(backend);
+
+    { // a slot resolved before its symbol is bound falls back to the name
+      std::istringstream iss("(+ x 1)");
+      REQUIRE(interp.parse(iss) == true);
+      REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+    }
+
+    { // bound in the same evaluation, after the slot was read
+      std::istringstream iss("(* x (define x 4))");
+      REQUIRE(interp.parse(iss) == true);
+      REQUIRE(interp.eval() == Expression(16.));
+    }
+
+    { // and in later programs
+      std::istringstream iss("(begin (define y (+ x 1)) (< x y))");
+      REQUIRE(interp.parse(iss) == true);
+      REQUIRE(interp.eval() == Expression(true));
+    }
+
+    { // symbols that are not arguments of an operator keep their identity
+      std::istringstream iss("(if (= x 4) x 0)");
+      REQUIRE(interp.parse(iss) == true);
+      REQUIRE(interp.eval() == Expression(std::string("x")));
+    }
+  }
+}
+
+TEST_CASE( "Test evaluating against environment snapshots", "[interpreter]" ) {
+
+  std::vector<Interpreter::Backend> backends = {
+    Interpreter::Backend::TreeWalker, Interpreter::Backend::FlatAST,
+    Interpreter::Backend::Bytecode, Interpreter::Backend::Jit
+  };
+  for (auto backend : backends) {
+    Interpreter interp;
+    interp.setBackend(backend);
+
+    std::istringstream preamble("(begin (define rate 2) (define base 10))");
+    REQUIRE(interp.parse(preamble) == true);
+    interp.eval();
+    EnvironmentSnapshot snapshot = interp.snapshot();
+
+    // a what-if scenario overriding one definition of the preamble
+    Environment scenario(snapshot);
+    scenario.define("rate", Expression(3.));
+    REQUIRE(scenario.symbols.size() == 1);
+    REQUIRE(scenario.get("base") == Expression(10.));
+
+    std::istringstream iss("(+ base (* rate 5))");
+    REQUIRE(interp.parse(iss) == true);
+    REQUIRE(interp.eval() == Expression(20.));
+
+    // forking re-resolves the parsed program against the scenario
+    interp.fork(std::make_shared<const Environment>(scenario));
+    REQUIRE(interp.eval() == Expression(25.));
+
+    interp.fork(snapshot);
+    REQUIRE(interp.eval() == Expression(20.));
+
+    { // defines in a fork stay in the fork
+      std::istringstream define("(define extra 1)");
+      REQUIRE(interp.parse(define) == true);
+      interp.eval();
+      REQUIRE(snapshot->lookup(intern("extra")) == nullptr);
+      interp.fork(snapshot);
+      std::istringstream use("(+ extra 1)");
+      REQUIRE(interp.parse(use) == true);
+      REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+    }
+  }
+
+  { // a snapshot of an unchanged fork is its parent
+    Environment env;
+    env.define("a", Expression(1.));
+    EnvironmentSnapshot first = env.snapshot();
+    REQUIRE(env.symbols.empty());
+    REQUIRE(env.snapshot() == first);
+    env.define("a", Expression(2.));
+    EnvironmentSnapshot second = env.snapshot();
+    REQUIRE(second != first);
+    REQUIRE(second->depth() == 1); // merged with the layer of its size below
+    REQUIRE(first->get("a") == Expression(1.));
+    REQUIRE(second->get("a") == Expression(2.));
+  }
+}
+
+TEST_CASE( "Test saving and loading environment images", "[environment]" ) {
+
+  Interpreter interp;
+  std::istringstream preamble(
+    "(begin (define half 0.5) (define twice (* 2 half)) (define on True) "
+    "(define off (not on)) (define tiny -0))");
+  REQUIRE(interp.parse(preamble) == true);
+  interp.eval();
+  EnvironmentSnapshot base = interp.snapshot();
+
+  // bindings of every layer are saved, the innermost winning
+  Environment scenario(base);
+  scenario.define("half", Expression(3.));
+  scenario.define("name", Expression(std::string("x")));
+
+  std::ostringstream out;
+  scenario.save(out);
+  std::string image = out.str();
+
+  std::istringstream in(image);
+  Environment loaded = Environment::load(in);
+  REQUIRE(loaded.symbols.size() == 6);
+  REQUIRE(loaded.get("half") == Expression(3.));
+  REQUIRE(loaded.get("twice") == Expression(1.));
+  REQUIRE(loaded.get("on") == Expression(true));
+  REQUIRE(loaded.get("off") == Expression(false));
+  REQUIRE(loaded.get("name") == Expression(std::string("x")));
+  REQUIRE(std::signbit(loaded.get("tiny").getNumber()));
+
+  // a loaded environment is a start-up snapshot like any other
+  interp.fork(std::make_shared<const Environment>(std::move(loaded)));
+  std::istringstream iss("(if (not off) (+ half twice) 0)");
+  REQUIRE(interp.parse(iss) == true);
+  REQUIRE(interp.eval() == Expression(4.));
+
+  { // damaged images are rejected
+    REQUIRE_THROWS_AS(Environment::load(image.data(), image.size() - 1), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(Environment::load(image.data(), 8), InterpreterSemanticError);
+    std::string wrong = image;
+    wrong[0] = 'X';
+    REQUIRE_THROWS_AS(Environment::load(wrong.data(), wrong.size()), InterpreterSemanticError);
+  }
+
+  { // an empty environment round-trips
+    std::ostringstream empty;
+    Environment().save(empty);
+    std::string bytes = empty.str();
+    REQUIRE(Environment::load(bytes.data(), bytes.size()).symbols.empty());
+  }
+}
+
+TEST_CASE( "Test interpreters sharing an environment across threads", "[environment]" ) {
+
+  auto shared = std::make_shared<SharedEnvironment>();
+  {
+    Environment constants;
+    constants.define("a", Expression(1.));
+    constants.define("b", Expression(2.));
+    shared->publish(constants);
+  }
+  REQUIRE(shared->version() == 2);
+
+  { // defines stay private and survive updates of the shared bindings
+    Interpreter interp;
+    interp.share(shared);
+    std::istringstream define("(define mine (+ a 10))");
+    REQUIRE(interp.parse(define) == true);
+    interp.eval();
+
+    Interpreter other;
+    other.share(shared);
+    std::istringstream use("(+ mine 1)");
+    REQUIRE(other.parse(use) == true);
+    REQUIRE_THROWS_AS(other.eval(), InterpreterSemanticError);
+
+    Environment update;
+    update.define("a", Expression(5.));
+    shared->publish(update);
+
+    std::istringstream sum("(+ mine a b)");
+    REQUIRE(interp.parse(sum) == true);
+    REQUIRE(interp.eval() == Expression(11. + 5. + 2.));
+  }
+
+  { // a parsed program picks up new versions at its next eval()
+    Interpreter interp;
+    interp.setBackend(Interpreter::Backend::Bytecode);
+    interp.share(shared);
+    std::istringstream iss("(* a b)");
+    REQUIRE(interp.parse(iss) == true);
+    REQUIRE(interp.eval() == Expression(10.));
+    Environment update;
+    update.define("b", Expression(3.));
+    shared->publish(update);
+    REQUIRE(interp.eval() == Expression(15.));
+  }
+
+  { // every reader sees each version whole while a writer publishes
+    Environment start;
+    start.define("a", Expression(0.));
+    start.define("b", Expression(0.));
+    shared->publish(start);
+
+    const int readers = 4;
+    std::atomic<bool> done(false);
+    std::atomic<int> torn(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < readers; ++i) {
+      threads.emplace_back([&shared, &done, &torn]() {
+        Interpreter interp;
+        interp.share(shared);
+        std::istringstream iss("(= b (* 2 a))");
+        interp.parse(iss);
+        while (!done.load()) {
+          if (!(interp.eval() == Expression(true))) {
+            ++torn;
+          }
+        }
+      });
+    }
+    for (int n = 1; n <= 200; ++n) {
+      Environment update;
+      update.define("a", Expression(double(n)));
+      update.define("b", Expression(2. * n));
+      shared->publish(update);
+    }
+    done = true;
+    for (std::thread & thread : threads) {
+      thread.join();
+    }
+    REQUIRE(torn.load() == 0);
+  }
+
+  REQUIRE(shared->current()->depth() <= SharedEnvironment::MaxDepth);
+}
+
+TEST_CASE( "Test one parsed program evaluated by many interpreters", "[interpreter]" ) {
+
+  REQUIRE(Program::parse(std::string("(+ 1")) == nullptr);
+
+  { // the program takes over a source moved into it rather than a copy
+    std::string source = "(begin (define answer 42) answer)";
+    const char* text = source.data();
+    std::shared_ptr<const Program> moved = Program::parse(std::move(source));
+    REQUIRE(moved != nullptr);
+    REQUIRE(moved->source().data() == text);
+  }
+
+  std::shared_ptr<const Program> program = Program::parse(std::string("(+ (* k 3) (- k 1))"));
+  REQUIRE(program != nullptr);
+
+  { // each interpreter binds the program's symbols in its own environment
+    std::vector<Interpreter::Backend> backends = {
+      Interpreter::Backend::TreeWalker, Interpreter::Backend::FlatAST,
+      Interpreter::Backend::Bytecode, Interpreter::Backend::Jit
+    };
+    std::vector<std::thread> threads;
+    std::atomic<int> wrong(0);
+    for (std::size_t i = 0; i < backends.size(); ++i) {
+      threads.emplace_back([&program, &wrong, &backends, i]() {
+        Interpreter interp;
+        interp.setBackend(backends[i]);
+        std::istringstream define("(define k " + std::to_string(i) + ")");
+        interp.parse(define);
+        interp.eval();
+
+        interp.load(program);
+        Expression expected(4. * i - 1);
+        for (int n = 0; n < 1000; ++n) {
+          if (!(interp.eval() == expected)) {
+            ++wrong;
+          }
+        }
+      });
+    }
+    for (std::thread & thread : threads) {
+      thread.join();
+    }
+    REQUIRE(wrong.load() == 0);
+  }
+
+  { // optimizing a shared program rewrites a private copy
+    Interpreter interp;
+    std::istringstream iss("(+ (* 2 3) (* k 1))");
+    REQUIRE(interp.parse(iss) == true);
+    std::shared_ptr<const Program> shared = interp.program();
+    REQUIRE(interp.optimize() > 0);
+    REQUIRE(interp.program() != shared);
+    REQUIRE(shared->root()->children[0]->children.size() == 2);
+
+    Interpreter other;
+    std::istringstream define("(define k 4)");
+    REQUIRE(other.parse(define) == true);
+    other.eval();
+    other.load(shared);
+    REQUIRE(other.eval() == Expression(10.));
+  }
+}
+
+TEST_CASE( "Test Arena release keeps its first block", "[arena]" ) {
+
+  Arena arena(256);
+  void* first = arena.allocate(16, 8);
+  for (int i = 0; i < 100; ++i) {
+    arena.allocate(64, 8);
+  }
+  arena.allocate(4096, 8); // an oversized block of its own
+
+  arena.release();
+  REQUIRE(arena.bytesUsed() == 0);
+  REQUIRE(arena.allocate(16, 8) == first);
+}
+
+TEST_CASE( "Test long chains of environment snapshots", "[environment]" ) {
+
+  std::vector<SymbolId> names;
+  for (int i = 0; i < 1000; ++i) {
+    names.push_back(intern("layer" + std::to_string(i)));
+  }
+
+  EnvironmentSnapshot first;
+  {
+    Environment env;
+    for (int i = 0; i < 1000000; ++i) {
+      env.define(names[i % 1000], Expression(double(i)));
+      EnvironmentSnapshot snapshot = env.snapshot();
+      if (i == 0) {
+        first = snapshot;
+      }
+    }
+    // layers grow geometrically instead of one per snapshot
+    REQUIRE(env.depth() <= 12);
+    REQUIRE(env.get(names[0]) == Expression(999000.));
+    REQUIRE(env.get(names[999]) == Expression(999999.));
+  } // releasing the chain must not overflow the stack
+
+  REQUIRE(first->symbols.size() == 1);
+  REQUIRE(first->get(names[0]) == Expression(0.));
+
+  { // a chain built by forking, one layer per fork, is released iteratively
+    EnvironmentSnapshot chain;
+    for (int i = 0; i < 1000000; ++i) {
+      std::shared_ptr<Environment> layer = std::make_shared<Environment>(chain);
+      layer->define(names[i % 1000], Expression(double(i)));
+      chain = layer;
+    }
+    REQUIRE(chain->depth() == 1000000);
+    chain.reset();
+  }
+}
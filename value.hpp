@@ -0,0 +1,109 @@
+// Value module declarations
+#ifndef VALUE_HPP
+#define VALUE_HPP
+
+// system includes
+#include <cstdint>
+#include <cstring>
+
+// module includes
+#include "expression.hpp"
+#include "interpreter_semantic_error.hpp"
+
+// 8-byte NaN-boxed value used on the evaluation hot path.
+//
+// A number is stored as its raw IEEE-754 bits. Everything else is stored
+// in the payload of a negative quiet NaN whose top 16 bits name the type:
+//
+//   0xFFF9 boolean   payload 0 or 1
+//   0xFFFA symbol    payload is a symbol id
+//   0xFFFB list      payload is a list handle
+//   0xFFFC none
+//
+// Hardware arithmetic only produces NaNs with the top 16 bits equal to
+// 0x7FF8 or 0xFFF8, which stay numbers. number() folds any other NaN that
+// would fall in the boxed range onto 0x7FF8, so a double can never be
+// mistaken for a boxed value.
+class Value {
+public:
+  Value() noexcept : m_bits(NoneTag) {}
+
+  static Value number(double num) noexcept {
+    Value value;
+    std::memcpy(&value.m_bits, &num, sizeof(num));
+    if (value.m_bits >= FirstBoxed) {
+      value.m_bits = CanonicalNaN;
+    }
+    return value;
+  }
+
+  static Value boolean(bool tf) noexcept { return fromBits(BooleanTag | (tf ? 1 : 0)); }
+  static Value symbol(std::uint32_t id) noexcept { return fromBits(SymbolTag | id); }
+  static Value list(std::uint32_t handle) noexcept { return fromBits(ListTag | handle); }
+
+  bool isNumber() const noexcept { return m_bits < FirstBoxed; }
+  bool isBool() const noexcept { return (m_bits & TagMask) == BooleanTag; }
+  bool isSymbol() const noexcept { return (m_bits & TagMask) == SymbolTag; }
+  bool isList() const noexcept { return (m_bits & TagMask) == ListTag; }
+  bool isNone() const noexcept { return m_bits == NoneTag; }
+
+  double asNumber() const noexcept {
+    double num;
+    std::memcpy(&num, &m_bits, sizeof(num));
+    return num;
+  }
+  bool asBool() const noexcept { return (m_bits & 1) != 0; }
+  std::uint32_t asSymbol() const noexcept { return static_cast<std::uint32_t>(m_bits); }
+  std::uint32_t asList() const noexcept { return static_cast<std::uint32_t>(m_bits); }
+
+  std::uint64_t bits() const noexcept { return m_bits; }
+
+private:
+  static Value fromBits(std::uint64_t bits) noexcept {
+    Value value;
+    value.m_bits = bits;
+    return value;
+  }
+
+  static const std::uint64_t TagMask = 0xFFFF000000000000ull;
+  static const std::uint64_t FirstBoxed = 0xFFF9000000000000ull;
+  static const std::uint64_t BooleanTag = 0xFFF9000000000000ull;
+  static const std::uint64_t SymbolTag = 0xFFFA000000000000ull;
+  static const std::uint64_t ListTag = 0xFFFB000000000000ull;
+  static const std::uint64_t NoneTag = 0xFFFC000000000000ull;
+  static const std::uint64_t CanonicalNaN = 0x7FF8000000000000ull;
+
+  std::uint64_t m_bits;
+};
+
+// Conversions between the evaluator's Values and Expressions. Symbols are
+// interned ids in both, so neither direction allocates.
+inline Value toValue(const Expression & expr) {
+  switch (expr.getType()) {
+    case ExpressionType::Boolean:
+      return Value::boolean(expr.getBool());
+    case ExpressionType::Number:
+      return Value::number(expr.getNumber());
+    case ExpressionType::Symbol:
+      return Value::symbol(expr.getSymbolId());
+    case ExpressionType::None:
+      return Value();
+    default:
+      throw InterpreterSemanticError("Lists have no Value encoding");
+  }
+}
+
+inline Expression toExpression(Value value) {
+  if (value.isNumber()) {
+    return Expression(value.asNumber());
+  }
+  if (value.isBool()) {
+    return Expression(value.asBool());
+  }
+  if (value.isSymbol()) {
+    return Expression::fromSymbol(value.asSymbol());
+  }
+  return Expression();
+}
+
+#endif